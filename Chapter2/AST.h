@@ -37,7 +37,7 @@
 //#include <system_error>
 //#include <utility>
 #include <vector>
-#include "../include/KaleidoscopeJIT.h"
+#include "KaleidoscopeJIT.h"
 
 using namespace llvm;
 using namespace llvm::orc;
@@ -46,14 +46,42 @@ class Bag {
 public:
 	BasicBlock * loop;
 	BasicBlock* after;
+	// ѭʱ LiveHeapArrays 
+	size_t HeapDepth;
 };
+/// SourceLocation - Byte offset of a token in the input.  The line and column
+/// are only worked out, from SourceLines, when debug info or a message needs
+/// them.
 struct SourceLocation {
+    uint32_t Offset;
+};
+
+/// LineCol - Line and column of a SourceLocation, both counted from 1.
+struct LineCol {
     int Line;
     int Col;
 };
 
-static SourceLocation CurLoc;
-static SourceLocation LexLoc = {1, 0};
+/// LineTable - Where the lines of the input start.  The lexer scans the whole
+/// buffer for them up front, or notes each one as it reads standard input.
+class LineTable {
+    std::vector<uint32_t> LineStarts{0};
+
+public:
+    /// reset - Start over with the input [Begin, End).
+    void reset(const char *Begin, const char *End);
+    /// addLineStart - A line starts at Offset, just after a '\n' or '\r'.
+    void addLineStart(uint32_t Offset) { LineStarts.push_back(Offset); }
+    /// getLineCol - Binary search for Loc's line.  A line break character (only
+    /// '\r' can be a token) is column 0 of the line it starts.
+    LineCol getLineCol(SourceLocation Loc) const;
+};
+
+/// SourceLines - The lines of the input being compiled; in Lexer.cpp.
+extern LineTable SourceLines;
+
+/// CurLoc - Start of the token the parser is looking at; it lives in Lexer.cpp.
+extern thread_local SourceLocation CurLoc;
 
 
 inline raw_ostream &debugIndent(raw_ostream &O, int size) {
@@ -63,15 +91,34 @@ inline raw_ostream &debugIndent(raw_ostream &O, int size) {
 /// ExprAST - Base class for all expression nodes.
 class ExprAST {
   SourceLocation Loc;
+
+protected:
+  /// takeOperands - Move the subexpressions out into Out.
+  virtual void takeOperands(SmallVectorImpl<std::unique_ptr<ExprAST>> &Out) {}
+  /// releaseOperands - Free the subexpressions with a work list, so that a
+  /// machine-generated tree a million levels deep does not overflow the stack
+  /// the way the destructors recursing into each other would.
+  void releaseOperands() {
+    SmallVector<std::unique_ptr<ExprAST>, 8> Pending;
+    takeOperands(Pending);
+    while (!Pending.empty()) {
+      std::unique_ptr<ExprAST> E = std::move(Pending.back());
+      Pending.pop_back();
+      E->takeOperands(Pending);
+    }
+  }
+
 public:
   ExprAST(SourceLocation Loc = CurLoc) : Loc(Loc) {}
   virtual ~ExprAST() = default;
 
   virtual Value *codegen() = 0;
-  int getLine() const { return Loc.Line; }
-  int getCol() const { return Loc.Col; }
+  SourceLocation getLoc() const { return Loc; }
+  int getLine() const { return SourceLines.getLineCol(Loc).Line; }
+  int getCol() const { return SourceLines.getLineCol(Loc).Col; }
   virtual raw_ostream &dump(raw_ostream &out, int ind) {
-        return out << ':' << getLine() << ':' << getCol() << '\n';
+        LineCol LC = SourceLines.getLineCol(Loc);
+        return out << ':' << LC.Line << ':' << LC.Col << '\n';
     }
 };
 
@@ -81,6 +128,7 @@ class NumberExprAST : public ExprAST {
 
 public:
   NumberExprAST(int Val) : Val(Val) {}
+  int getVal() const { return Val; }
   raw_ostream &dump(raw_ostream &out, int ind) override {
         return ExprAST::dump(out << Val, ind);
     }
@@ -116,14 +164,29 @@ public:
   BinaryExprAST(SourceLocation Loc, char Op, std::unique_ptr<ExprAST> LHS,
                 std::unique_ptr<ExprAST> RHS)
       : ExprAST(Loc), Op(Op), LHS(std::move(LHS)), RHS(std::move(RHS)) {}
+  ~BinaryExprAST() override { releaseOperands(); }
+
+  char getOp() const { return Op; }
+  ExprAST *getLHS() const { return LHS.get(); }
+  ExprAST *getRHS() const { return RHS.get(); }
 
   Value *codegen() override;
+  /// codegenOp - The instructions for Op applied to the values of LHS and RHS.
+  Value *codegenOp(Value *L, Value *R);
   raw_ostream &dump(raw_ostream &out, int ind) override {
         ExprAST::dump(out << "binary" << Op, ind);
         LHS->dump(debugIndent(out, ind) << "LHS:", ind + 1);
         RHS->dump(debugIndent(out, ind) << "RHS:", ind + 1);
         return out;
     }
+
+protected:
+  void takeOperands(SmallVectorImpl<std::unique_ptr<ExprAST>> &Out) override {
+    if (LHS)
+      Out.push_back(std::move(LHS));
+    if (RHS)
+      Out.push_back(std::move(RHS));
+  }
 };
 
 /// UnaryExprAST - Expression class for a unary operator.
@@ -134,6 +197,7 @@ class UnaryExprAST : public ExprAST {
 public:
   UnaryExprAST(char Opcode, std::unique_ptr<ExprAST> Operand)
       : Opcode(Opcode), Operand(std::move(Operand)) {}
+  ~UnaryExprAST() override { releaseOperands(); }
 
   Value *codegen() override;
   raw_ostream &dump(raw_ostream &out, int ind) override {
@@ -141,6 +205,12 @@ public:
         Operand->dump(out, ind + 1);
         return out;
     }
+
+protected:
+  void takeOperands(SmallVectorImpl<std::unique_ptr<ExprAST>> &Out) override {
+    if (Operand)
+      Out.push_back(std::move(Operand));
+  }
 };
 
 /// CallExprAST - Expression class for function calls.
@@ -152,6 +222,7 @@ public:
   CallExprAST(SourceLocation Loc,const std::string &Callee,
               std::vector<std::unique_ptr<ExprAST>> Args)
       : ExprAST(Loc), Callee(Callee), Args(std::move(Args)) {}
+  ~CallExprAST() override { releaseOperands(); }
 
   Value *codegen() override;
   raw_ostream &dump(raw_ostream &out, int ind) override {
@@ -160,6 +231,38 @@ public:
             Arg->dump(debugIndent(out, ind + 1), ind + 1);
         return out;
     }
+
+protected:
+  void takeOperands(SmallVectorImpl<std::unique_ptr<ExprAST>> &Out) override {
+    for (auto &Arg : Args)
+      if (Arg)
+        Out.push_back(std::move(Arg));
+    Args.clear();
+  }
+};
+/// ArrayIndexExprAST - Expression class for reading an array element, like "a[i]".
+class ArrayIndexExprAST : public ExprAST {
+  std::string Name;
+  std::unique_ptr<ExprAST> Index;
+
+public:
+  ArrayIndexExprAST(SourceLocation Loc, const std::string &Name,
+                    std::unique_ptr<ExprAST> Index)
+      : ExprAST(Loc), Name(Name), Index(std::move(Index)) {}
+  ~ArrayIndexExprAST() override { releaseOperands(); }
+
+  Value *codegen() override;
+  raw_ostream &dump(raw_ostream &out, int ind) override {
+        ExprAST::dump(out << "index " << Name, ind);
+        Index->dump(debugIndent(out, ind) << "Index:", ind + 1);
+        return out;
+    }
+
+protected:
+  void takeOperands(SmallVectorImpl<std::unique_ptr<ExprAST>> &Out) override {
+    if (Index)
+      Out.push_back(std::move(Index));
+  }
 };
 class TextExprAST : public ExprAST {
 	std::string Text;
@@ -186,10 +289,12 @@ public:
     virtual ~StatAST()= default;
     
     virtual Value *codegen() = 0;
-    int getLine() const { return Loc.Line; }
-    int getCol() const { return Loc.Col; }
+    SourceLocation getLoc() const { return Loc; }
+    int getLine() const { return SourceLines.getLineCol(Loc).Line; }
+    int getCol() const { return SourceLines.getLineCol(Loc).Col; }
     virtual raw_ostream &dump(raw_ostream &out, int ind) {
-        return out << ':' << getLine() << ':' << getCol() << '\n';
+        LineCol LC = SourceLines.getLineCol(Loc);
+        return out << ':' << LC.Line << ':' << LC.Col << '\n';
     }
 };
 
@@ -200,12 +305,16 @@ class PrototypeAST {
   //SourceLocation Loc;
   std::string Name;
   std::vector<std::string> Args;
+  std::vector<bool> ArrayArgs; //ΪĲ飬 (׵ַ, ) 
+  std::vector<Attribute::AttrKind> FnAttrs;    //ÿģЩ
+  std::vector<Attribute::AttrKind> ArrayAttrs; //׵ַ
   bool IsOperator; //Ƿһ
   unsigned Precedence; //ԭΪһ˫ĿʱԴ洢ȼ
-  int Line;
+  SourceLocation Loc;
 public:
-  PrototypeAST(const std::string &Name, std::vector<std::string> Args,bool IsOperator=false, unsigned Precedence = 0)
-      : Name(Name), Args(std::move(Args)), IsOperator(IsOperator), Precedence(Precedence) {}
+  PrototypeAST(const std::string &Name, std::vector<std::string> Args,bool IsOperator=false, unsigned Precedence = 0,
+               SourceLocation Loc = CurLoc)
+      : Name(Name), Args(std::move(Args)), IsOperator(IsOperator), Precedence(Precedence), Loc(Loc) {}
 
   Function *codegen();
   const std::string &getName() const { return Name; }
@@ -214,6 +323,12 @@ public:
 	   std::vector<std::string> V(args);
 	   Args = std::move(V);
    }
+   void setArrayArgs(std::vector<bool> arrayArgs) { ArrayArgs = std::move(arrayArgs); }
+   bool isArrayArg(unsigned i) const { return i < ArrayArgs.size() && ArrayArgs[i]; }
+   /// addFnAttr/addArrayAttr - Attributes codegen() gives the function, or
+   /// each array base parameter, in whichever module declares it.
+   void addFnAttr(Attribute::AttrKind Kind) { FnAttrs.push_back(Kind); }
+   void addArrayAttr(Attribute::AttrKind Kind) { ArrayAttrs.push_back(Kind); }
 
   bool isUnaryOp() const {
     return IsOperator && Args.size() == 1;
@@ -228,7 +343,7 @@ public:
   }
 
   unsigned getBinaryPrecedence() const { return Precedence; }
-  int getLine() const { return Line; }
+  int getLine() const { return SourceLines.getLineCol(Loc).Line; }
   
 };
 
@@ -236,12 +351,21 @@ public:
 class FunctionAST {
   std::unique_ptr<PrototypeAST> Proto;
   std::unique_ptr<StatAST> Body;
+  std::vector<std::string> Callees; // sorted, no duplicates
+  std::string SourceHash;           // MD5 of the tokens, see TokenHash
 
 public:
   FunctionAST(std::unique_ptr<PrototypeAST> Proto,
-              std::unique_ptr<StatAST> Body)
-      : Proto(std::move(Proto)), Body(std::move(Body)) {}
-
+              std::unique_ptr<StatAST> Body,
+              std::vector<std::string> Callees = {})
+      : Proto(std::move(Proto)), Body(std::move(Body)),
+        Callees(std::move(Callees)) {}
+
+  const PrototypeAST &getProto() const { return *Proto; }
+  /// getCallees - Functions and operators the body calls.
+  const std::vector<std::string> &getCallees() const { return Callees; }
+  const std::string &getSourceHash() const { return SourceHash; }
+  void setSourceHash(std::string Hash) { SourceHash = std::move(Hash); }
   Function *codegen();
   raw_ostream &dump(raw_ostream &out, int ind) {
         debugIndent(out, ind) << "FunctionAST\n";
@@ -255,9 +379,12 @@ public:
 /// NumberExprAST - Expression class for numeric literals like "1.0".
 class AssignStatAST : public StatAST {
 	std::string Name;
+	std::unique_ptr<ExprAST> Index; // ǿʱΪԪظֵ a[i] := expr
 	std::unique_ptr<ExprAST> Val;
 public:
 	AssignStatAST(SourceLocation Loc, const std::string &Name, std::unique_ptr<ExprAST> Val) : StatAST(Loc), Name(Name), Val(std::move(Val)) {}
+	AssignStatAST(SourceLocation Loc, const std::string &Name, std::unique_ptr<ExprAST> Index, std::unique_ptr<ExprAST> Val)
+		: StatAST(Loc), Name(Name), Index(std::move(Index)), Val(std::move(Val)) {}
 
 	Value *codegen() override;
     raw_ostream &dump(raw_ostream &out, int ind) override {
@@ -350,6 +477,8 @@ class BlockStatAST : public StatAST {
 	//std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> VarNames;
 	//std::vector<std::unique_ptr<ExprAST>> Variables;
 	std::vector<std::string> Variables;
+	//  VAR a[size]size Ϊʱջϣڶ
+	std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> Arrays;
 	std::vector<std::unique_ptr<StatAST>> Statements;
 	//std::map<std::string, llvm::Value*> locals;
 public:
@@ -362,6 +491,10 @@ public:
 		: StatAST(Loc), Variables(std::move(Variables)), Statements(std::move(Statements)) {}*/
 	BlockStatAST(SourceLocation Loc, std::vector<std::string> Variables, std::vector<std::unique_ptr<StatAST>> Statements)
 		: StatAST(Loc), Variables(std::move(Variables)), Statements(std::move(Statements)) {}
+	BlockStatAST(SourceLocation Loc, std::vector<std::string> Variables,
+		std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> Arrays,
+		std::vector<std::unique_ptr<StatAST>> Statements)
+		: StatAST(Loc), Variables(std::move(Variables)), Arrays(std::move(Arrays)), Statements(std::move(Statements)) {}
 
 	Value *codegen() override;
     raw_ostream &dump(raw_ostream &out, int ind) override {
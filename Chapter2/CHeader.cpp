@@ -0,0 +1,77 @@
+#include "CHeader.h"
+#include "Global.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include <cctype>
+
+using namespace llvm;
+
+/// isCKeyword - Whether a VSL name cannot be a parameter name in C or C++.
+static bool isCKeyword(StringRef Name) {
+	static const char *const Keywords[] = {
+		"auto", "bool", "break", "case", "char", "class", "const", "continue",
+		"default", "delete", "do", "double", "else", "enum", "extern", "float",
+		"for", "goto", "if", "inline", "int", "long", "namespace", "new",
+		"operator", "private", "protected", "public", "register", "restrict",
+		"return", "short", "signed", "sizeof", "static", "struct", "switch",
+		"template", "this", "typedef", "union", "unsigned", "using", "virtual",
+		"void", "volatile", "while"};
+	for (const char *K : Keywords)
+		if (Name == K)
+			return true;
+	return false;
+}
+
+/// getGuard - The include guard for a header called Filename.
+static std::string getGuard(StringRef Filename) {
+	std::string Guard;
+	for (char C : sys::path::filename(Filename))
+		Guard += isalnum((unsigned char)C) ? toupper((unsigned char)C) : '_';
+	if (Guard.empty() || isdigit((unsigned char)Guard[0]))
+		Guard = "VSL_" + Guard;
+	return Guard;
+}
+
+bool writeCHeader(StringRef Filename) {
+	std::error_code EC;
+	raw_fd_ostream OS(Filename, EC, sys::fs::F_Text);
+	if (EC) {
+		errs() << "Could not open " << Filename << ": " << EC.message() << "\n";
+		return false;
+	}
+
+	std::string Guard = getGuard(Filename);
+	OS << "/* Generated by vsl --shared.  VSL integers are 32-bit ints; an array\n"
+	   << "   argument is passed as a pointer to its first element and its length. */\n"
+	   << "#ifndef " << Guard << "\n#define " << Guard << "\n\n"
+	   << "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n";
+	// FunctionProtos also holds the runtime's functions.  They are declared
+	// in TheModule, or, once -runtime-bc has linked them in, defined with
+	// internal linkage; either way the library does not export them.
+	for (const auto &P : FunctionProtos) {
+		const PrototypeAST &Proto = *P.second;
+		Function *F = TheModule->getFunction(Proto.getName());
+		if (!F || F->isDeclaration() || !F->hasExternalLinkage() ||
+		    Proto.getName() == "main" ||
+		    Proto.isUnaryOp() || Proto.isBinaryOp())
+			continue;
+		OS << "int " << Proto.getName() << "(";
+		std::vector<std::string> Args = Proto.getArgs();
+		if (Args.empty())
+			OS << "void";
+		for (unsigned i = 0, e = Args.size(); i != e; ++i) {
+			std::string Name = Args[i];
+			if (isCKeyword(Name))
+				Name += '_';
+			if (i)
+				OS << ", ";
+			if (Proto.isArrayArg(i))
+				OS << "int *" << Name << ", int " << Name << "_len";
+			else
+				OS << "int " << Name;
+		}
+		OS << ");\n";
+	}
+	OS << "\n#ifdef __cplusplus\n}\n#endif\n\n#endif /* " << Guard << " */\n";
+	return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#ifndef CHEADER
+#define CHEADER
+#include "llvm/ADT/StringRef.h"
+
+//===----------------------------------------------------------------------===//
+// --shared: the C header declaring what a VSL shared library exports
+//===----------------------------------------------------------------------===//
+
+/// writeCHeader - Write to Filename a C (and C++) header with the prototype of
+/// every FUNC TheModule defines and exports, from FunctionProtos.  main and operator
+/// definitions have no C name and are left out.  Returns false, having said
+/// why, if the file cannot be written.
+bool writeCHeader(llvm::StringRef Filename);
+
+#endif // !CHEADER
@@ -1,6 +1,9 @@
 #pragma once
 #include "DebugInfo.h"
+#include "Profile.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/IR/MDBuilder.h"
+#include <set>
 
 
 using namespace llvm;
@@ -36,6 +39,164 @@ static AllocaInst *CreateEntryBlockAlloca(Function *TheFunction,
 }
 
 
+//===----------------------------------------------------------------------===//
+// Array Support
+//===----------------------------------------------------------------------===//
+
+/// Constant-sized arrays with more elements than this go on the heap, so that
+/// large arrays cannot overflow the native stack.
+static const uint64_t MaxStackArrayLength = 16384;
+
+/// InRangeFacts - Index variables whose current value is known to be below a
+/// constant bound, as established by the condition of the enclosing
+/// "WHILE i < N" loop and not reassigned since.  Indexing an array of at
+/// least N elements with such a variable needs no bounds check, which keeps
+/// the loop body free of early exits so the loop vectorizer can handle it.
+static std::map<AllocaInst *, uint64_t> InRangeFacts;
+/// StoredVariables - Variables assigned since the innermost loop was entered.
+static std::set<AllocaInst *> StoredVariables;
+
+/// noteStore - Forget what we knew about a variable that is being assigned.
+static void noteStore(AllocaInst *Alloca) {
+	InRangeFacts.erase(Alloca);
+	StoredVariables.insert(Alloca);
+}
+
+/// getLoopBound - Recognize a "i < N" loop condition with a constant N.  '<'
+/// compares unsigned, so it also proves i is not negative.
+static bool getLoopBound(ExprAST *Cond, AllocaInst *&Var, uint64_t &Bound) {
+	BinaryExprAST *Cmp = dynamic_cast<BinaryExprAST *>(Cond);
+	if (!Cmp || Cmp->getOp() != '<')
+		return false;
+	VariableExprAST *LHS = dynamic_cast<VariableExprAST *>(Cmp->getLHS());
+	NumberExprAST *RHS = dynamic_cast<NumberExprAST *>(Cmp->getRHS());
+	if (!LHS || !RHS || RHS->getVal() <= 0)
+		return false;
+	Var = NamedValues.lookup(LHS->getName());
+	if (!Var)
+		return false;
+	Bound = RHS->getVal();
+	return true;
+}
+
+/// CreateEntryBlockArray - Create a fixed-size stack array in the entry block
+/// of the function.
+static AllocaInst *CreateEntryBlockArray(Function *TheFunction,
+	const std::string &VarName, uint64_t Length) {
+	IRBuilder<> TmpB(&TheFunction->getEntryBlock(),
+		TheFunction->getEntryBlock().begin());
+	return TmpB.CreateAlloca(ArrayType::get(Type::getInt32Ty(TheContext), Length),
+		nullptr, VarName.c_str());
+}
+
+/// CreateHeapArray - Allocate a zero-filled array of Length elements with calloc.
+/// A length that is not positive, or a failed calloc, calls vsl_alloc_fail.
+static Value *CreateHeapArray(Value *Length, const std::string &VarName,
+	int Line) {
+	Function *TheFunction = Builder.GetInsertBlock()->getParent();
+	Function *FailF = getFunction("vsl_alloc_fail");
+	if (!FailF)
+		return LogErrorV("Unknown function referenced");
+	BasicBlock *FailBB = BasicBlock::Create(TheContext, "allocfail", TheFunction);
+	BasicBlock *SizeOkBB = BasicBlock::Create(TheContext, "allocsize", TheFunction);
+	BasicBlock *OkBB = BasicBlock::Create(TheContext, "allocok", TheFunction);
+	MDBuilder MDB(TheContext);
+
+	// Ϊʱչõһ޴ calloc ֮ǰܾ
+	Value *Positive = Builder.CreateICmpSGT(Length, Builder.getInt32(0), "lenpos");
+	Builder.CreateCondBr(Positive, SizeOkBB, FailBB, MDB.createBranchWeights(2000, 1));
+
+	Builder.SetInsertPoint(SizeOkBB);
+	Type *SizeTy = Builder.getInt64Ty();
+	Constant *CallocF = TheModule->getOrInsertFunction(
+		"calloc", Builder.getInt8PtrTy(), SizeTy, SizeTy);
+	Value *Count = Builder.CreateZExt(Length, SizeTy, "count");
+	Value *Mem = Builder.CreateCall(CallocF, { Count, ConstantInt::get(SizeTy, 4) },
+		VarName + ".mem");
+	Value *Allocated = Builder.CreateIsNotNull(Mem, "allocated");
+	Builder.CreateCondBr(Allocated, OkBB, FailBB, MDB.createBranchWeights(2000, 1));
+
+	Builder.SetInsertPoint(FailBB);
+	Builder.CreateCall(FailF, { Length, Builder.getInt32(Line) });
+	Builder.CreateUnreachable();
+
+	Builder.SetInsertPoint(OkBB);
+	return Builder.CreateBitCast(Mem, Builder.getInt32Ty()->getPointerTo(), VarName);
+}
+
+/// FreeHeapArray - Release an array allocated by CreateHeapArray.
+static void FreeHeapArray(Value *Base) {
+	Constant *FreeF = TheModule->getOrInsertFunction(
+		"free", Builder.getVoidTy(), Builder.getInt8PtrTy());
+	Builder.CreateCall(FreeF, Builder.CreateBitCast(Base, Builder.getInt8PtrTy()));
+}
+
+/// LiveHeapArrays - Heap arrays of the blocks being generated, innermost last.
+/// A CONTINUE leaves every block opened since its loop was entered, so it must
+/// free the arrays above the loop's Bag::HeapDepth before it branches.
+static std::vector<Value *> LiveHeapArrays;
+
+/// HeapArrayScope - Pops the heap arrays a block pushed on LiveHeapArrays when
+/// the block's code generation ends, whether or not it succeeded.
+struct HeapArrayScope {
+	size_t Depth;
+	HeapArrayScope() : Depth(LiveHeapArrays.size()) {}
+	~HeapArrayScope() { LiveHeapArrays.resize(Depth); }
+};
+
+/// freeHeapArraysAbove - Free the live heap arrays above Depth, innermost first.
+static void freeHeapArraysAbove(size_t Depth) {
+	for (size_t i = LiveHeapArrays.size(); i > Depth; --i)
+		FreeHeapArray(LiveHeapArrays[i - 1]);
+}
+
+/// emitElementAddress - Compute the address of Name[Index].  A bounds check
+/// calling vsl_bounds_fail is emitted unless the index is provably in range.
+static Value *emitElementAddress(const std::string &Name, ExprAST *Index,
+	int Line) {
+	ArrayBinding Array = NamedArrays.lookup(Name);
+	if (!Array.Base)
+		return LogErrorV("Unknown array name");
+
+	Value *IdxV = Index->codegen();
+	if (!IdxV)
+		return nullptr;
+
+	bool Proven = false;
+	if (VariableExprAST *IdxVar = dynamic_cast<VariableExprAST *>(Index)) {
+		auto Fact = InRangeFacts.find(NamedValues.lookup(IdxVar->getName()));
+		Proven = Fact != InRangeFacts.end() && Fact->second <= Array.ConstLength;
+	}
+	else if (NumberExprAST *IdxNum = dynamic_cast<NumberExprAST *>(Index)) {
+		Proven = IdxNum->getVal() >= 0 &&
+			(uint64_t)IdxNum->getVal() < Array.ConstLength;
+	}
+
+	if (!Proven) {
+		Function *TheFunction = Builder.GetInsertBlock()->getParent();
+		BasicBlock *FailBB = BasicBlock::Create(TheContext, "outofbounds", TheFunction);
+		BasicBlock *OkBB = BasicBlock::Create(TheContext, "inbounds", TheFunction);
+		// ޷űȽͬʱų˸±
+		Value *InRange = Builder.CreateICmpULT(IdxV, Array.Length, "boundcheck");
+		MDBuilder MDB(TheContext);
+		Builder.CreateCondBr(InRange, OkBB, FailBB, MDB.createBranchWeights(2000, 1));
+
+		Builder.SetInsertPoint(FailBB);
+		Function *FailF = getFunction("vsl_bounds_fail");
+		if (!FailF)
+			return LogErrorV("Unknown function referenced");
+		Builder.CreateCall(FailF, Builder.getInt32(Line));
+		Builder.CreateUnreachable();
+
+		Builder.SetInsertPoint(OkBB);
+	}
+
+	Value *Offset = Builder.CreateZExt(IdxV, Builder.getInt64Ty(), "idxext");
+	return Builder.CreateInBoundsGEP(Builder.getInt32Ty(), Array.Base, Offset,
+		"arrayidx");
+}
+
+
 //===----------------------------------------------------------------------===//
 // Debug Info Support
 //===----------------------------------------------------------------------===//
@@ -44,6 +205,13 @@ std::unique_ptr<DIBuilder> DBuilder;
 
 
 static DISubroutineType *CreateFunctionType(unsigned NumArgs, DIFile *Unit) {
+    // Every function type is int(int, ...), so one per arity is enough.
+    auto &Types = KSDbgInfo.FunctionTypes;
+    if (NumArgs < Types.size() && Types[NumArgs])
+        return Types[NumArgs];
+    if (NumArgs >= Types.size())
+        Types.resize(NumArgs + 1);
+
     SmallVector<Metadata *, 8> EltTys;
     DIType *DblTy = KSDbgInfo.getIntTy();
     
@@ -53,7 +221,9 @@ static DISubroutineType *CreateFunctionType(unsigned NumArgs, DIFile *Unit) {
     for (unsigned i = 0, e = NumArgs; i != e; ++i)
         EltTys.push_back(DblTy);
     
-    return DBuilder->createSubroutineType(DBuilder->getOrCreateTypeArray(EltTys));
+    Types[NumArgs] =
+        DBuilder->createSubroutineType(DBuilder->getOrCreateTypeArray(EltTys));
+    return Types[NumArgs];
 }
 
 Value *NumberExprAST::codegen() {
@@ -65,7 +235,7 @@ Value *NumberExprAST::codegen() {
 
 Value *VariableExprAST::codegen() {
 	// Look this variable up in the function.
-	Value *V = NamedValues[Name];
+	Value *V = NamedValues.lookup(Name);
 	if (!V)
 		return LogErrorV("Unknown variable name");
     KSDbgInfo.emitLocation(this);
@@ -74,6 +244,15 @@ Value *VariableExprAST::codegen() {
 }
 
 
+Value *ArrayIndexExprAST::codegen() {
+	KSDbgInfo.emitLocation(this);
+	Value *Addr = emitElementAddress(Name, Index.get(), getLine());
+	if (!Addr)
+		return nullptr;
+	return Builder.CreateLoad(Addr, Name.c_str());
+}
+
+
 Value * TextExprAST::codegen()
 {
 	//return Constant::get(TheContext, StringRef(Text));
@@ -82,8 +261,21 @@ Value * TextExprAST::codegen()
 	
 }
 
+/// SymbolScope - Keeps a block scope open in NamedValues and NamedArrays for
+/// its lifetime, so the bindings are dropped on every return path.
+struct SymbolScope {
+	SymbolScope() {
+		NamedValues.pushScope();
+		NamedArrays.pushScope();
+	}
+	~SymbolScope() {
+		NamedValues.popScope();
+		NamedArrays.popScope();
+	}
+};
+
 Value *VarExprAST::codegen() {
-	std::vector<AllocaInst *> OldBindings;
+	SymbolScope Scope;
 
 	Function *TheFunction = Builder.GetInsertBlock()->getParent();
 
@@ -107,11 +299,8 @@ Value *VarExprAST::codegen() {
 		AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, VarName);
 		Builder.CreateStore(InitVal, Alloca);
 
-		// ñǰֵOldBindingsУԱڸָ
-		OldBindings.push_back(NamedValues[VarName]);
-
-		// ¼˴ΰ󶨵ֵ
-		NamedValues[VarName] = Alloca;
+		// ¼˴ΰ󶨵ֵڱͬʱԶָ
+		NamedValues.bind(VarName, Alloca);
 	}
     KSDbgInfo.emitLocation(this);
 	// bodyֵĴ, жı
@@ -119,11 +308,6 @@ Value *VarExprAST::codegen() {
 	if (!BodyVal)
 		return nullptr;
 
-	// ɾǰееı
-	for (unsigned i = 0, e = VarNames.size(); i != e; ++i)
-		// ָԭֵ
-		NamedValues[VarNames[i].first] = OldBindings[i];
-
 	// Bodyֵļ
 	return BodyVal;
 }
@@ -159,19 +343,42 @@ Value *BinaryExprAST::codegen() {
 			return nullptr;
 
 		// Ѱұ
-		Value *Variable = NamedValues[LHSE->getName()];
+		AllocaInst *Variable = NamedValues.lookup(LHSE->getName());
 		if (!Variable)
 			return LogErrorV("Unknown variable name");
 
+		noteStore(Variable);
 		Builder.CreateStore(Val, Variable);
 		return Val;
 	}
 
-	Value *L = LHS->codegen();
-	Value *R = RHS->codegen();
-	if (!L || !R)
-		return nullptr;
+	// A long chain like a + b - c * d + ... is a tree leaning to the left as
+	// deep as the chain is long.  Walk down its left spine with a loop and
+	// generate the operators on the way back up, instead of recursing once per
+	// operator.  Each operator's instruction gets the operator's own location,
+	// not that of the operand generated just before it.
+	SmallVector<BinaryExprAST *, 16> Spine;
+	Spine.push_back(this);
+	ExprAST *Leaf = LHS.get();
+	while (auto *B = dynamic_cast<BinaryExprAST *>(Leaf)) {
+		if (B->Op == '=')
+			break;
+		Spine.push_back(B);
+		Leaf = B->LHS.get();
+	}
 
+	Value *L = Leaf->codegen();
+	for (BinaryExprAST *B : llvm::reverse(Spine)) {
+		Value *R = B->RHS->codegen();
+		if (!L || !R)
+			return nullptr;
+		KSDbgInfo.emitLocation(B);
+		L = B->codegenOp(L, R);
+	}
+	return L;
+}
+
+Value *BinaryExprAST::codegenOp(Value *L, Value *R) {
 	switch (Op) {
 	case '+':
 		return Builder.CreateAdd(L, R, "addtmp");
@@ -180,11 +387,11 @@ Value *BinaryExprAST::codegen() {
 	case '*':
 		return Builder.CreateMul(L, R, "multmp");
 	case '/':
-		return Builder.CreateExactSDiv(L, R, "divtmp");
+		return Builder.CreateSDiv(L, R, "divtmp");
 	case '<':
 		L = Builder.CreateICmpULT(L, R, "cmptmp");
-		// Convert bool 0/1 to double 0.0 or 1.0
-		return Builder.CreateUIToFP(L, Type::getInt32Ty(TheContext), "booltmp");
+		// Convert bool 0/1 to int 0 or 1
+		return Builder.CreateZExt(L, Type::getInt32Ty(TheContext), "booltmp");
 	default:
 		//return LogErrorV("invalid binary operator");
         //Ϊִ
@@ -206,27 +413,34 @@ Value *CallExprAST::codegen() {
 	Function *CalleeF = TheModule->getFunction(Callee);*/
 	//޸ĺ
 	// Look up the name in the global module table.
+	// кԭڴǰѵǼǣ HandleDefinition
+	// ˵ÿֱָ򱻵䶨˳
 	Function *CalleeF = getFunction(Callee);
-	//if (isMain&&CalleeF==nullptr) {
-	if (CalleeF == nullptr) {
-		std::vector<std::string> ArgNames;
-		//ʱ洢ƣΪֵʱټ
-		for (int i = 0; i < Args.size();i++) {
-			ArgNames.push_back("temp"+i);
-		}
-		MainLackOfProtos[Callee]= llvm::make_unique<PrototypeAST>(Callee, std::move(ArgNames));
-		
-		CalleeF = getLackFunction(Callee);
-	}
 	if (!CalleeF)
 		return LogErrorV("Unknown function referenced");
 
+	//  (׵ַ, ) ֵ
+	auto PI = FunctionProtos.find(Callee);
+	PrototypeAST *CalleeP = PI != FunctionProtos.end() ? PI->second.get() : nullptr;
+	unsigned NumArgs = CalleeP ? CalleeP->getArgs().size() : CalleeF->arg_size();
+
 	// If argument mismatch error.
-	if (CalleeF->arg_size() != Args.size())
+	if (NumArgs != Args.size())
 		return LogErrorV("Incorrect # arguments passed");
 
 	std::vector<Value *> ArgsV;
 	for (unsigned i = 0, e = Args.size(); i != e; ++i) {
+		if (CalleeP && CalleeP->isArrayArg(i)) {
+			VariableExprAST *ArrRef = dynamic_cast<VariableExprAST *>(Args[i].get());
+			if (!ArrRef)
+				return LogErrorV("Expected an array argument");
+			ArrayBinding Array = NamedArrays.lookup(ArrRef->getName());
+			if (!Array.Base)
+				return LogErrorV("Unknown array name");
+			ArgsV.push_back(Array.Base);
+			ArgsV.push_back(Array.Length);
+			continue;
+		}
 		ArgsV.push_back(Args[i]->codegen());
 		if (!ArgsV.back())
 			return nullptr;
@@ -243,7 +457,21 @@ Function *PrototypeAST::codegen() {
 		return (Function*)LogErrorV("Prototype already exist.");
 
 	// Make the function type:  int(int,int) etc.
-	std::vector<Type*> Integers(Args.size(), Type::getInt32Ty(TheContext));
+	// An array argument becomes two parameters: int* and its int length.
+	std::vector<Type*> Integers;
+	std::vector<std::string> ParamNames;
+	for (unsigned i = 0, e = Args.size(); i != e; ++i) {
+		if (isArrayArg(i)) {
+			Integers.push_back(Type::getInt32PtrTy(TheContext));
+			Integers.push_back(Type::getInt32Ty(TheContext));
+			ParamNames.push_back(Args[i]);
+			ParamNames.push_back(Args[i] + ".len");
+		}
+		else {
+			Integers.push_back(Type::getInt32Ty(TheContext));
+			ParamNames.push_back(Args[i]);
+		}
+	}
 	FunctionType *FT =
 		FunctionType::get(Type::getInt32Ty(TheContext), Integers, false);
 
@@ -254,7 +482,17 @@ Function *PrototypeAST::codegen() {
 	// Set names for all arguments.
 	unsigned Idx = 0;
 	for (auto &Arg : F->args())
-		Arg.setName(Args[Idx++]);
+		Arg.setName(ParamNames[Idx++]);
+
+	for (Attribute::AttrKind Kind : FnAttrs)
+		F->addFnAttr(Kind);
+	for (unsigned i = 0, Param = 0, e = Args.size(); i != e; ++i, ++Param) {
+		if (!isArrayArg(i))
+			continue;
+		for (Attribute::AttrKind Kind : ArrayAttrs)
+			F->addParamAttr(Param, Kind);
+		++Param; // the length
+	}
 
 	return F;
 }
@@ -263,65 +501,33 @@ Function *FunctionAST::codegen() {
 	//ӶȫֺԭͱFunctionProtos޸ģ޸getFunctionķʽ
 	auto &P = *Proto;
 
-	//ӹmain߼-------------------------------------------
-	//	if (P.getName() == "main")
-	//		isMain = true;
-	//check if main already exists
-	Function *TheFunction;
-	std::unique_ptr<PrototypeAST>temp;
-	//if (hasMainFunction) {
-	temp = std::move(MainLackOfProtos[Proto->getName()]);
-	//}
-	//if (hasMainFunction&&temp != nullptr) {
-	if (temp != nullptr) {
-		auto args = temp->getArgs();
-		auto Args = P.getArgs();
-		if (args.size() != Args.size()) {
-			//args inconsistency
-			return LogErrorF("main function's arg_size is inconsistent");
-		}
-		//P.setArgs(args);
-		temp->setArgs(Args);
-		FunctionProtos[Proto->getName()] = std::move(temp);
-		MainLackOfProtos.erase(Proto->getName());
-		TheFunction = getFunction(P.getName());
-		if (!TheFunction)
-			return nullptr;
-		unsigned Idx = 0;
-		for (auto &Arg : TheFunction->args())
-			Arg.setName(Args[Idx++]);
-	}
-	//main-------------------------------------------
-	else {
-		FunctionProtos[Proto->getName()] = std::move(Proto);
-		TheFunction = getFunction(P.getName());
-		if (!TheFunction)
-			return nullptr;
-	}
-//old edition
-//if op add it and its precedence to binopprecedence
-	if (P.isBinaryOp())
-          BinopPrecedence[P.getOperatorName()] = P.getBinaryPrecedence();
+	// ԭ HandleDefinition Ǽǣﻻɶԭ
+	FunctionProtos[Proto->getName()] = std::move(Proto);
+	Function *TheFunction = getFunction(P.getName());
+	if (!TheFunction)
+		return nullptr;
 
 	// Create a new basic block to start insertion into.
 	BasicBlock *BB = BasicBlock::Create(TheContext, "entry", TheFunction);
 	Builder.SetInsertPoint(BB);
 
     // Create a subprogram DIE for this function.
-    DIFile *Unit = DBuilder->createFile(KSDbgInfo.TheCU->getFilename(),
-                                        KSDbgInfo.TheCU->getDirectory());
-    DIScope *FContext = Unit;
+    DIFile *Unit = KSDbgInfo.Unit;
     unsigned LineNo = P.getLine();
-    unsigned ScopeLine = LineNo;
-    DISubprogram *SP = DBuilder->createFunction(
-                                                FContext, P.getName(), StringRef(), Unit, LineNo,
-                                                CreateFunctionType(TheFunction->arg_size(), Unit),
-                                                false /* internal linkage */, true /* definition */, ScopeLine,
-                                                DINode::FlagPrototyped, false);
-    TheFunction->setSubprogram(SP);
-    
-    // Push the current scope.
-    KSDbgInfo.LexicalBlocks.push_back(SP);
+    DISubprogram *SP = nullptr;
+    if (KSDbgInfo.enabled()) {
+        DIScope *FContext = Unit;
+        unsigned ScopeLine = LineNo;
+        SP = DBuilder->createFunction(
+                                      FContext, P.getName(), StringRef(), Unit, LineNo,
+                                      CreateFunctionType(TheFunction->arg_size(), Unit),
+                                      false /* internal linkage */, true /* definition */, ScopeLine,
+                                      DINode::FlagPrototyped, false);
+        TheFunction->setSubprogram(SP);
+
+        // Push the current scope.
+        KSDbgInfo.LexicalBlocks.push_back(SP);
+    }
     
     // Unset the location for the prologue emission (leading instructions with no
     // location in a function are considered part of the prologue and the debugger
@@ -330,25 +536,35 @@ Function *FunctionAST::codegen() {
     KSDbgInfo.emitLocation(exprnull);
 	// Record the function arguments in the NamedValues map.
 	NamedValues.clear();
+	NamedArrays.clear();
+	InRangeFacts.clear();
+	StoredVariables.clear();
     unsigned ArgIdx = 0;
 	for (auto &Arg : TheFunction->args()) {
 		// Create an alloca for this variable.
 		AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, Arg.getName());
         // Create a debug descriptor for the variable.
-        DILocalVariable *D = DBuilder->createParameterVariable(
-                                                               SP, Arg.getName(), ++ArgIdx, Unit, LineNo, KSDbgInfo.getIntTy(),
-                                                               true);
-
-        DBuilder->insertDeclare(Alloca, D, DBuilder->createExpression(),
-                                DebugLoc::get(LineNo, 0, SP),
-                                Builder.GetInsertBlock());
+        if (KSDbgInfo.Level == FullDebugInfo) {
+            DILocalVariable *D = DBuilder->createParameterVariable(
+                                                                   SP, Arg.getName(), ++ArgIdx, Unit, LineNo, KSDbgInfo.getIntTy(),
+                                                                   true);
+
+            DBuilder->insertDeclare(Alloca, D, DBuilder->createExpression(),
+                                    DebugLoc::get(LineNo, 0, SP),
+                                    Builder.GetInsertBlock());
+        }
 
 		// Store the initial value into the alloca.
 		Builder.CreateStore(&Arg, Alloca);
 
 		// Add arguments to variable symbol table.
-		NamedValues[Arg.getName()] = Alloca;
+		NamedValues.bind(Arg.getName(), Alloca);
 	}
+	if (ProfilingEnabled)
+		emitProfileCounter(SiteEntry, P.getName(), P.getLine(), 0);
+	if (ProfileUseEnabled)
+		if (auto Count = getProfileCount(SiteEntry, P.getName(), P.getLine(), 0))
+			TheFunction->setEntryCount(*Count);
     KSDbgInfo.emitLocation(Body.get());
     
 	if (Value *RetVal = Body->codegen()) {
@@ -356,13 +572,13 @@ Function *FunctionAST::codegen() {
 		Builder.CreateRet(RetVal);
         
         // Pop off the lexical block for the function.
-        KSDbgInfo.LexicalBlocks.pop_back();
+        if (SP)
+            KSDbgInfo.LexicalBlocks.pop_back();
 
 		// Validate the generated code, checking for consistency.
 		verifyFunction(*TheFunction);
 
-		// Run the optimizer on the function.
-		TheFPM->run(*TheFunction);
+		// The caller runs TheFPM on the function, see CodegenDefinitions.
 
 		//isMainֵ
 		if (P.getName() == "main") {
@@ -373,14 +589,18 @@ Function *FunctionAST::codegen() {
 		return TheFunction;
 	}
 
-	// Error reading body, remove function.
-	TheFunction->eraseFromParent();
+	// Error reading body, remove function.  Functions generated earlier may
+	// already call it, in that case only the body goes.
+	if (TheFunction->use_empty())
+		TheFunction->eraseFromParent();
+	else
+		TheFunction->deleteBody();
     if (P.isBinaryOp())
-        BinopPrecedence.erase(Proto->getOperatorName());
+        BinopPrecedence.erase(P.getOperatorName());
     
-    // Pop off the lexical block for the function since we added it
-    // unconditionally.
-    KSDbgInfo.LexicalBlocks.pop_back();
+    // Pop off the lexical block for the function if we added one.
+    if (SP)
+        KSDbgInfo.LexicalBlocks.pop_back();
 	return nullptr;
 }
 
@@ -402,8 +622,22 @@ Value * AssignStatAST::codegen()
 	*/
 
     KSDbgInfo.emitLocation(this);
+	// Ԫظֵ
+	if (Index) {
+		Value *Addr = emitElementAddress(Name, Index.get(), getLine());
+		if (!Addr)
+			return nullptr;
+		Value *result = Val ? Val->codegen() : nullptr;
+		if (!result)
+			return nullptr;
+		Builder.CreateStore(result, Addr);
+		return result;
+	}
+
 	// Look up the name.
-	AllocaInst *Alloca = NamedValues[Name];
+	AllocaInst *Alloca = NamedValues.lookup(Name);
+	if (!Alloca)
+		return LogErrorV("Unknown variable name");
 	
 	Value * result=nullptr;
 	if(Val)
@@ -413,6 +647,7 @@ Value * AssignStatAST::codegen()
 		return nullptr;
 
 	//Value* load = new LoadInst(result, "", false, BB);
+	noteStore(Alloca);
 	Builder.CreateStore(result, Alloca);
 	return result;
 	
@@ -510,16 +745,19 @@ Value * IfStatAST::codegen()
 	BasicBlock *ThenBB = BasicBlock::Create(TheContext, "then", TheFunction);
 	BasicBlock *ElseBB = ElseBB = BasicBlock::Create(TheContext, "else");
 	BasicBlock *MergeBB = BasicBlock::Create(TheContext, "ifcont");
-	if (ElseStat != nullptr) {
-		Builder.CreateCondBr(CondV, ThenBB, ElseBB);
+	// û ELSE ʱ else ֱת ifcont֤ PHI ǰȷ
+	BranchInst *Br = Builder.CreateCondBr(CondV, ThenBB, ElseBB);
+	if (ProfileUseEnabled) {
+		auto ThenCount = getProfileCount(SiteThen, TheFunction->getName(), getLine(), getCol());
+		auto ElseCount = getProfileCount(SiteElse, TheFunction->getName(), getLine(), getCol());
+		if (ThenCount && ElseCount)
+			setProfileWeights(Br, *ThenCount, *ElseCount);
 	}
-	else {
-		Builder.CreateCondBr(CondV, ThenBB, MergeBB);
-	}
-	
 
 	// Emit then value.
 	Builder.SetInsertPoint(ThenBB);
+	if (ProfilingEnabled)
+		emitProfileCounter(SiteThen, TheFunction->getName(), getLine(), getCol());
 
 	Value *ThenV = ThenStat->codegen();
 	if (!ThenV)
@@ -532,14 +770,15 @@ Value * IfStatAST::codegen()
 	// Emit else block.
 	TheFunction->getBasicBlockList().push_back(ElseBB);
 	Builder.SetInsertPoint(ElseBB);
+	if (ProfilingEnabled)
+		emitProfileCounter(SiteElse, TheFunction->getName(), getLine(), getCol());
 	Value *ElseV;
 	if (ElseStat != nullptr) {
 		ElseV = ElseStat->codegen();
 		if (!ElseV)
 			return nullptr;
-		Builder.CreateBr(MergeBB);
-
 	}
+	Builder.CreateBr(MergeBB);
 	ElseBB = Builder.GetInsertBlock();
 	// Emit merge block.
 	TheFunction->getBasicBlockList().push_back(MergeBB);
@@ -618,40 +857,66 @@ Value * IfStatAST::codegen()
 Value * WhileStatAST::codegen()
 {
 	KSDbgInfo.emitLocation(this);
+
+	// ȡڹĵǰFunction
+	Function *TheFunction = Builder.GetInsertBlock()->getParent();
+	if (ProfilingEnabled)
+		emitProfileCounter(SiteLoopEntry, TheFunction->getName(), getLine(), getCol());
 	
 	//ѭ
 	Value *Condition = WhileCondition->codegen();
 	if (!Condition)
 		return nullptr;
-    
-	// ȡڹĵǰFunction
-	Function *TheFunction = Builder.GetInsertBlock()->getParent();
-    
 
+
+	// -profile ʱѭıߵɿ飬ͳѭӶĴ
+	BasicBlock *EnterBB = ProfilingEnabled ?
+		BasicBlock::Create(TheContext, "loopenter", TheFunction) : nullptr;
 	// create loop block
 	BasicBlock *LoopBB = BasicBlock::Create(TheContext, "loop", TheFunction);
+	// create condition block, CONTINUE jumps here
+	BasicBlock *CondBB = BasicBlock::Create(TheContext, "loopcond");
 	// create after block
-	BasicBlock *AfterBB = BasicBlock::Create(TheContext, "afterloop", TheFunction);
+	BasicBlock *AfterBB = BasicBlock::Create(TheContext, "afterloop");
     
 	// 0Ƚ
 	Condition = Builder.CreateICmpNE(Condition, Builder.getInt32(0), "whilecond");
 	//Condition = Builder.CreateFCmpONE(Condition, ConstantInt::get(TheContext, APInt(32,0)), "whilecond");
 	// branch base on startcond
-	Builder.CreateCondBr(Condition, LoopBB, AfterBB);
-	parent->loop = LoopBB;
-	parent->after = AfterBB;
+	BranchInst *EnterBr = Builder.CreateCondBr(Condition, EnterBB ? EnterBB : LoopBB, AfterBB);
+	if (EnterBB) {
+		Builder.SetInsertPoint(EnterBB);
+		emitProfileCounter(SiteLoopRun, TheFunction->getName(), getLine(), getCol());
+		Builder.CreateBr(LoopBB);
+	}
 	
 	// insert LoopBB.
 	Builder.SetInsertPoint(LoopBB);
+	if (ProfilingEnabled)
+		emitProfileCounter(SiteLoop, TheFunction->getName(), getLine(), getCol());
 	
-	parent->loop = LoopBB;
+	parent->loop = CondBB;
 	parent->after = AfterBB;
+	parent->HeapDepth = LiveHeapArrays.size();
+
+	// ѭ忪ʼֻбѭ±귶Χѭٻָ
+	std::map<AllocaInst *, uint64_t> OuterFacts = std::move(InRangeFacts);
+	std::set<AllocaInst *> OuterStored = std::move(StoredVariables);
+	InRangeFacts.clear();
+	StoredVariables.clear();
+	AllocaInst *IndVar;
+	uint64_t Bound;
+	if (getLoopBound(WhileCondition.get(), IndVar, Bound))
+		InRangeFacts[IndVar] = Bound;
+
 	// Do statement м
 	if (!DoStat->codegen())
 		return nullptr;
-
+	Builder.CreateBr(CondBB);
 
 	//ѭ
+	TheFunction->getBasicBlockList().push_back(CondBB);
+	Builder.SetInsertPoint(CondBB);
 	Condition = WhileCondition->codegen();
 	if (!Condition)
 		return nullptr;
@@ -660,12 +925,31 @@ Value * WhileStatAST::codegen()
     //Condition=Builder.CreateFCmpONE(Condition, ConstantInt::get(TheContext, APInt(32,0)), "whilecond");
 
     // branch base on endcond
-    Builder.CreateCondBr(Condition, LoopBB, AfterBB);
+    BranchInst *BackBr = Builder.CreateCondBr(Condition, LoopBB, AfterBB);
+	if (ProfileUseEnabled) {
+		auto Entered = getProfileCount(SiteLoopEntry, TheFunction->getName(), getLine(), getCol());
+		auto Ran = getProfileCount(SiteLoopRun, TheFunction->getName(), getLine(), getCol());
+		auto Iterations = getProfileCount(SiteLoop, TheFunction->getName(), getLine(), getCol());
+		if (Entered && Ran && Iterations) {
+			// ÿδӶѭ壬ն loopcond ˳һ
+			setProfileWeights(EnterBr, *Ran, *Entered - *Ran);
+			setProfileWeights(BackBr, *Iterations - *Ran, *Ran);
+		}
+	}
 
 
 	// code afterwards added to afterbb
+	TheFunction->getBasicBlockList().push_back(AfterBB);
 	Builder.SetInsertPoint(AfterBB);
 
+	// ѭбֵıķΧʵʧЧ
+	for (AllocaInst *Stored : StoredVariables) {
+		OuterFacts.erase(Stored);
+		OuterStored.insert(Stored);
+	}
+	InRangeFacts = std::move(OuterFacts);
+	StoredVariables = std::move(OuterStored);
+
 	// whileѭĴǷ0.0
 	return Constant::getNullValue(Type::getInt32Ty(TheContext));
 }
@@ -674,10 +958,46 @@ Value * WhileStatAST::codegen()
 Value * BlockStatAST::codegen()
 {
     KSDbgInfo.emitLocation(this);
-	std::vector<AllocaInst *> OldBindings;
+	SymbolScope Scope;
+	HeapArrayScope HeapScope;
 
 	Function *TheFunction = Builder.GetInsertBlock()->getParent();
 
+	// עе飬СΪķջϣڶ
+	for (unsigned i = 0, e = Arrays.size(); i != e; ++i) {
+		const std::string &ArrName = Arrays[i].first;
+		ExprAST *Size = Arrays[i].second.get();
+
+		ArrayBinding Array;
+		if (NumberExprAST *SizeNum = dynamic_cast<NumberExprAST *>(Size)) {
+			if (SizeNum->getVal() <= 0)
+				return LogErrorV("array size must be positive");
+			Array.ConstLength = SizeNum->getVal();
+			Array.Length = Builder.getInt32(SizeNum->getVal());
+		}
+		else {
+			Array.ConstLength = 0;
+			Array.Length = Size->codegen();
+			if (!Array.Length)
+				return nullptr;
+		}
+		Array.OnHeap = !Array.ConstLength || Array.ConstLength > MaxStackArrayLength;
+
+		if (Array.OnHeap) {
+			Array.Base = CreateHeapArray(Array.Length, ArrName, Size->getLine());
+			if (!Array.Base)
+				return nullptr;
+			LiveHeapArrays.push_back(Array.Base);
+		}
+		else {
+			AllocaInst *Alloca = CreateEntryBlockArray(TheFunction, ArrName, Array.ConstLength);
+			Array.Base = Builder.CreateConstInBoundsGEP2_32(Alloca->getAllocatedType(), Alloca, 0, 0, ArrName);
+			Builder.CreateMemSet(Array.Base, Builder.getInt8(0), Array.ConstLength * 4, 4);
+		}
+
+		NamedArrays.bind(ArrName, Array);
+	}
+
 	// עеı
 	for (unsigned i = 0, e = Variables.size(); i != e; ++i) {
 		const std::string &VarName = Variables[i];
@@ -691,11 +1011,8 @@ Value * BlockStatAST::codegen()
 		AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, VarName);
 		Builder.CreateStore(InitVal, Alloca);
 
-		// ñǰֵOldBindingsУԱڸָ
-		OldBindings.push_back(NamedValues[VarName]);
-
-		// ¼˴ΰ󶨵ֵ
-		NamedValues[VarName] = Alloca;
+		// ¼˴ΰ󶨵ֵڱͬʱԶָ
+		NamedValues.bind(VarName, Alloca);
 	}
 
 	// bodyֵĴ, жı
@@ -707,10 +1024,8 @@ Value * BlockStatAST::codegen()
 	if (!ret)
 		return nullptr;
 
-	// ɾǰееı
-	for (unsigned i = 0, e = Variables.size(); i != e; ++i)
-		// ָԭֵ
-		NamedValues[Variables[i]] = OldBindings[i];
+	// ͷŶϵ
+	freeHeapArraysAbove(HeapScope.Depth);
 
 	// Bodyֵļ
 	return ret;
@@ -770,7 +1085,12 @@ Value * ContinueStatAST::codegen()
 	KSDbgInfo.emitLocation(this);
 	//parent->con = Builder.CreateFCmpONE(ConstantFP::get(TheContext, APFloat(1.0)), ConstantFP::get(TheContext, APFloat(0.0)), "whilecond");
 	//Builder.CreateCondBr(ConstantFP::get(TheContext, APFloat(1.0)), parent->loop, parent->after);
+	// ѭѴ򿪵Ŀ飬ͷЩڶϵ
+	freeHeapArraysAbove(parent->HeapDepth);
 	Builder.CreateBr(parent->loop);
+	// CONTINUE ֮䲻ɴµĻ飬֤ÿֻһսָ
+	Function *TheFunction = Builder.GetInsertBlock()->getParent();
+	Builder.SetInsertPoint(BasicBlock::Create(TheContext, "aftercontinue", TheFunction));
 	return ConstantInt::get(TheContext, APInt(32,1));
 }
 
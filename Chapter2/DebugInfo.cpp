@@ -6,6 +6,37 @@
 
 DebugInfo KSDbgInfo;
 
+void DebugInfo::initializeModule() {
+	LexicalBlocks.clear();
+	if (!enabled()) {
+		DBuilder.reset();
+		return;
+	}
+	// Add the current debug info version into the module.
+	TheModule->addModuleFlag(Module::Warning, "Debug Info Version",
+		DEBUG_METADATA_VERSION);
+	// Darwin only supports dwarf2.
+	if (Triple(sys::getProcessTriple()).isOSDarwin())
+		TheModule->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 2);
+
+	// Construct the DIBuilder, we do this here because we need the module.
+	DBuilder = llvm::make_unique<DIBuilder>(*TheModule);
+
+	// Create the compile unit for the module.
+	// Currently down as "fib" as a filename since we're redirecting stdin
+	// but we'd like actual source locations.
+	Unit = DBuilder->createFile("fib", ".");
+	TheCU = DBuilder->createCompileUnit(
+		dwarf::DW_LANG_C, Unit, "VSL Compiler", 0, "", 0, "",
+		Level == LineTablesOnly ? DICompileUnit::LineTablesOnly
+		                        : DICompileUnit::FullDebug);
+}
+
+void DebugInfo::finalize() {
+	if (DBuilder)
+		DBuilder->finalize();
+}
+
 // DIType *DebugInfo::getDoubleTy() {
 //	if (DblTy)
 //		return DblTy;
@@ -3,12 +3,32 @@
 #define DEBUGINFO
 
 #include "Global.h"
+
+/// DebugInfoLevel - How much debug info -g asks for.
+enum DebugInfoLevel {
+	NoDebugInfo,    ///< -g0: no DIBuilder, no locations
+	LineTablesOnly, ///< -g1: subprograms and line locations
+	FullDebugInfo   ///< -g2: also the parameters as variables
+};
+
 struct DebugInfo {
+	DebugInfoLevel Level = FullDebugInfo;
 	DICompileUnit *TheCU;
+	DIFile *Unit; // the CU's file, shared by all subprograms
 	DIType *DblTy;
+	std::vector<DISubroutineType *> FunctionTypes; // by number of arguments
 	std::vector<DIScope *> LexicalBlocks;
 
+	bool enabled() const { return Level != NoDebugInfo; }
+
+	/// initializeModule - Set up DBuilder and the compile unit for TheModule.
+	void initializeModule();
+	/// finalize - Finish the debug info of TheModule.
+	void finalize();
+
 	void emitLocation(ExprAST *ast) {
+		if (!enabled())
+			return;
 		if (!ast)
 			return Builder.SetCurrentDebugLocation(DebugLoc());
 		DIScope *Scope;
@@ -16,11 +36,15 @@ struct DebugInfo {
 			Scope = TheCU;
 		else
 			Scope = LexicalBlocks.back();
-		Builder.SetCurrentDebugLocation(
-			DebugLoc::get(ast->getLine(), ast->getCol(), Scope));
+		// The node keeps only its offset; SourceLines turns it into a line
+		// and a column here.
+		LineCol LC = SourceLines.getLineCol(ast->getLoc());
+		Builder.SetCurrentDebugLocation(DebugLoc::get(LC.Line, LC.Col, Scope));
 	}
 
 	void emitLocation(StatAST *ast) {
+		if (!enabled())
+			return;
 		if (!ast)
 			return Builder.SetCurrentDebugLocation(DebugLoc());
 		DIScope *Scope;
@@ -28,8 +52,10 @@ struct DebugInfo {
 			Scope = TheCU;
 		else
 			Scope = LexicalBlocks.back();
-		Builder.SetCurrentDebugLocation(
-			DebugLoc::get(ast->getLine(), ast->getCol(), Scope));
+		// The node keeps only its offset; SourceLines turns it into a line
+		// and a column here.
+		LineCol LC = SourceLines.getLineCol(ast->getLoc());
+		Builder.SetCurrentDebugLocation(DebugLoc::get(LC.Line, LC.Col, Scope));
 	}
 	DIType *getIntTy() {
 		if (DblTy)
@@ -1,22 +1,93 @@
 #pragma once
+#include "DebugInfo.h"
 #include "Global.h"
+#include "TimeReport.h"
+#include "TokenBuffer.h"
 //ʱע
 //#include <fstream>
 //#include <iostream>
 #include <string>
 
-std::string IdentifierStr;
-int NumVal;
-std::string Text;
+thread_local std::string IdentifierStr;
+thread_local int NumVal;
+thread_local std::string Text;
+thread_local StringRef CurStr;
 //===-------------------
 // Parser
 //===--------------------
-int CurTok = 0;
-int getNextToken() { return CurTok = gettok(); }
+thread_local int CurTok = 0;
+thread_local MD5 *TokenHash = nullptr;
+
+/// hashToken - Add CurTok, which is about to be consumed, to H.
+static void hashToken(MD5 &H) {
+  auto Bytes = [&H](const void *P, size_t N) {
+    H.update(ArrayRef<uint8_t>(static_cast<const uint8_t *>(P), N));
+  };
+  Bytes(&CurTok, sizeof(CurTok));
+  switch (CurTok) {
+  case VARIABLE:
+  case TEXT:
+    Bytes(CurStr.data(), CurStr.size());
+    Bytes("", 1);
+    break;
+  case INTEGER:
+    Bytes(&NumVal, sizeof(NumVal));
+    break;
+  }
+  // Locations reach the object even without -g: bounds checks pass the line
+  // to vsl_bounds_fail.  Lines and columns, unlike offsets, stay the same
+  // when an earlier line is edited.
+  LineCol LC = SourceLines.getLineCol(CurLoc);
+  Bytes(&LC.Line, sizeof(LC.Line));
+  Bytes(&LC.Col, sizeof(LC.Col));
+}
+
+/// nextPreLexed - Move to the next token of PreLexed.  CurStr is pointed at
+/// the interned string rather than copying it.
+static int nextPreLexed() {
+  const TokenBuffer &B = *PreLexed;
+  // Stay on the final TOKEOF.
+  if (PreLexedPos + 1 < B.size())
+    ++PreLexedPos;
+  CurTok = B.Kinds[PreLexedPos];
+  CurLoc = B.getLoc(PreLexedPos);
+  uint32_t Payload = B.Payloads[PreLexedPos];
+  if (CurTok == VARIABLE || CurTok == TEXT)
+    CurStr = B.Strings[Payload];
+  else if (CurTok == INTEGER)
+    NumVal = (int)Payload;
+  return CurTok;
+}
+
+/// nextLexed - Lex the next token on demand.
+static int nextLexed() {
+  CurTok = gettok();
+  if (CurTok == VARIABLE)
+    CurStr = IdentifierStr;
+  else if (CurTok == TEXT)
+    CurStr = Text;
+  return CurTok;
+}
+
+int getNextToken() {
+  if (TokenHash)
+    hashToken(*TokenHash);
+  if (PreLexed)
+    return nextPreLexed();
+  if (!TimePhasesEnabled)
+    return nextLexed();
+  auto Start = std::chrono::steady_clock::now();
+  nextLexed();
+  LexWallTime += std::chrono::steady_clock::now() - Start;
+  return CurTok;
+}
 
 /// BinopPrecedence - This holds the precedence for each binary operator that is
 /// defined.
-std::map<char, int> BinopPrecedence;
+OperatorTable BinopPrecedence;
+
+/// ParsedCallees - Functions called by the definition being parsed.
+thread_local std::vector<std::string> ParsedCallees;
 
 std::string getTokName(int Tok) {
   switch (Tok) {
@@ -56,24 +127,6 @@ std::string getTokName(int Tok) {
   return std::string(1, (char)Tok);
 }
 
-/// ָʾ
-int indent = 0;
-
-/// ļ
-//ʱע
-// static std::ofstream fout;
-static bool isFirstOpenFile = true;
-void outputToTxt(std::string str) {
-  //Ϊ벻ʱע
-  /* if (isFirstOpenFile) {
-     fout.open("output.txt", std::ios::trunc);
-         isFirstOpenFile = false;
-   }else fout.open("output.txt", std::ios::app);
-   if (fout.is_open()) {
-     fout << str;
-   }
-   fout.close();*/
-}
 //ʱע
 // static std::ofstream errorFout;
 static bool isErrorFirstOpenFile = true;
@@ -114,8 +167,11 @@ std::unique_ptr<StatAST> LogErrorS(const char *Str) {
 // TheContext);
 std::unique_ptr<Module> TheModule;
 // std::map<std::string, Value *> NamedValues;
-std::map<std::string, AllocaInst *> NamedValues;
+ScopedSymbolTable<AllocaInst *> NamedValues;
+ScopedSymbolTable<ArrayBinding> NamedArrays;
 
  std::unique_ptr<legacy::FunctionPassManager> TheFPM;
 std::unique_ptr<KaleidoscopeJIT> TheJIT;
 std::map<std::string, std::unique_ptr<PrototypeAST>> FunctionProtos;
+unsigned OptLevel = 2;
+std::string ObjectCacheDir;
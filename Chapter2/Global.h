@@ -2,7 +2,9 @@
 #ifndef  GLOBAL
 #define GLOBAL
 #include "AST.h"
+#include "SymbolTable.h"
 //#include "../include/KaleidoscopeJIT.h"
+#include "llvm/Support/MD5.h"
 #include <map>
 
 using namespace llvm;
@@ -19,9 +21,14 @@ using namespace llvm::sys;
 // Lexer
 //===----------------------------------------------------------------------===//
 
-extern std::string IdentifierStr;
-extern int NumVal;
-extern std::string Text;
+extern thread_local std::string IdentifierStr;
+extern thread_local int NumVal;
+extern thread_local std::string Text;
+/// CurStr - The spelling of CurTok when it is a VARIABLE or TEXT.  With
+/// pre-lexed input it refers to the buffer's interned string, so nothing is
+/// copied until the parser keeps the name; IdentifierStr and Text are then
+/// left alone.  Valid until the next getNextToken.
+extern thread_local StringRef CurStr;
 enum Token {
 	VARIABLE = -1,
 	INTEGER = -2,
@@ -80,6 +87,17 @@ extern std::unique_ptr<DIBuilder> DBuilder;
 extern bool recWhitespace(int LastChar);
 extern int recKeyword();
 extern int gettok();
+/// setLexerBuffer - Lex [Begin, End), the whole input, instead of standard
+/// input, and find its lines for SourceLines.  The buffer must outlive the
+/// tokens read from it.
+extern void setLexerBuffer(const char *Begin, const char *End);
+/// setLexerBuffer - Lex [Begin, End), a part of the input starting at byte
+/// Offset, whose lines SourceLines already has.  Only the calling thread's
+/// lexer state changes.
+extern void setLexerBuffer(const char *Begin, const char *End, uint32_t Offset);
+/// getTokenRange - Offset and length in the setLexerBuffer buffer of the
+/// token gettok returned last.
+extern void getTokenRange(uint32_t &Offset, uint32_t &Length);
 
 //===----------------------------------------------------------------------===//
 // Parser
@@ -88,17 +106,43 @@ extern int gettok();
 /// CurTok/getNextToken - Provide a simple token buffer.  CurTok is the current
 /// token the parser is looking at.  getNextToken reads another token from the
 /// lexer and updates CurTok with its results.
-extern int CurTok;
+extern thread_local int CurTok;
 extern int getNextToken();
+/// TokenHash - While set, getNextToken adds every token it consumes to it
+/// (kind, value and, with debug info, location).
+extern thread_local MD5 *TokenHash;
+
+/// OperatorTable - Precedence of the binary operators, one entry per
+/// character, so looking up any token is a single load.  All binary
+/// operators are left associative.
+class OperatorTable {
+	uint8_t Precedences[256] = {}; // 0: not a binary operator
+
+public:
+	/// getPrecedence - The precedence of token Tok, -1 if it is not a binary
+	/// operator.
+	int getPrecedence(int Tok) const {
+		if ((unsigned)Tok >= 128)
+			return -1;
+		int Prec = Precedences[Tok];
+		return Prec ? Prec : -1;
+	}
+	/// add - Make Op a binary operator; Prec is 1..255.
+	void add(char Op, unsigned Prec) {
+		assert(Prec > 0 && Prec < 256 && "precedence out of range");
+		Precedences[(unsigned char)Op] = (uint8_t)Prec;
+	}
+	void erase(char Op) { Precedences[(unsigned char)Op] = 0; }
+};
 
 /// BinopPrecedence - This holds the precedence for each binary operator that is
 /// defined.
-extern std::map<char, int> BinopPrecedence;
+extern OperatorTable BinopPrecedence;
+
+/// ParsedCallees - Names of the functions (operators included) called by the
+/// definition being parsed; ParseDefinition hands them to its FunctionAST.
+extern thread_local std::vector<std::string> ParsedCallees;
 
-/// ļ
-void outputToTxt(std::string str);
-/// ָʾ
-extern int indent;
 
 extern std::unique_ptr<ExprAST> LogError(const char *Str);
 extern std::unique_ptr<PrototypeAST> LogErrorP(const char *Str);
@@ -106,20 +150,48 @@ extern std::unique_ptr<PrototypeAST> LogErrorP(const char *Str);
 std::unique_ptr<StatAST> LogErrorS(const char *Str);
 
 extern std::unique_ptr<ExprAST> ParseExpression();
+extern std::unique_ptr<FunctionAST> ParseDefinition();
 //statement
 extern std::unique_ptr<StatAST> ParseStatement();
-//statementҪø
-std::unique_ptr<ExprAST> ParseIdentifierExpr();
 extern void HandleDefinition();
+/// ParseTopLevelDefinition - ParseDefinition, plus the source hash -cache-dir
+/// needs.  Touches no state shared between threads.
+extern std::unique_ptr<FunctionAST> ParseTopLevelDefinition();
+/// AddDefinition - Register a parsed definition's prototype (and operator
+/// precedence) and queue it for code generation.
+extern void AddDefinition(std::unique_ptr<FunctionAST> FnAST);
+extern void CodegenDefinitions();
+/// StreamReadyDefinitions - -stream: generate code for every parsed definition
+/// whose callees all have prototypes, each in a module of its own handed to
+/// the JIT.  Returns true once main and everything it calls, transitively,
+/// is in the JIT.
+extern bool StreamReadyDefinitions();
+/// reportUnstreamedDefinitions - -stream, at the end of the input: report the
+/// definitions still waiting for a callee that was never defined.
+extern void reportUnstreamedDefinitions();
 
 //===----------------------------------------------------------------------===//
 // Code Generation
 //===----------------------------------------------------------------------===//
 
 extern std::unique_ptr<Module> TheModule;
-extern std::map<std::string, AllocaInst *> NamedValues;
 //extern std::map<std::string, Value *> NamedValues;
 
+/// ArrayBinding - Storage of an array variable: Base points at the first i32
+/// element, Length is the element count (ConstLength is non-zero when it is
+/// known at compile time).
+struct ArrayBinding {
+	Value *Base;
+	Value *Length;
+	uint64_t ConstLength;
+	bool OnHeap;
+};
+
+/// NamedValues/NamedArrays - Scalar and array variables visible at the current
+/// point of code generation.
+extern ScopedSymbolTable<AllocaInst *> NamedValues;
+extern ScopedSymbolTable<ArrayBinding> NamedArrays;
+
 
 
 
@@ -131,14 +203,27 @@ extern std::map<std::string, AllocaInst *> NamedValues;
 extern std::unique_ptr<legacy::FunctionPassManager> TheFPM;
 extern std::unique_ptr<KaleidoscopeJIT> TheJIT;
 extern std::map<std::string, std::unique_ptr<PrototypeAST>> FunctionProtos;
+/// OptLevel - Optimization level 0-3 given by -O; selects the pass pipeline
+/// and the code generator level of the object file.
+extern unsigned OptLevel;
+/// ObjectCacheDir - Directory given by -cache-dir; when set, every definition
+/// is compiled on its own and its object file kept there for the next run.
+extern std::string ObjectCacheDir;
+/// CodegenDefinitionsCached - -cache-dir: add every parsed definition to the
+/// JIT, reusing the cached object file of those whose tokens, callee
+/// prototypes and compiler options have not changed since it was compiled.
+extern void CodegenDefinitionsCached();
 //optimize
 extern void InitializeModule();
+extern void OptimizeModule();
+/// LinkRuntimeBitcode - Link the runtime functions TheModule calls from the
+/// bitcode file Path (vsl_runtime.bc), before OptimizeModule, so that they can
+/// be inlined.  Returns false, having said why, if Path cannot be read.
+extern bool LinkRuntimeBitcode(StringRef Path);
 Function *getFunction(std::string Name);
 //support main()
 //extern bool isMain;
-extern std::map<std::string, std::unique_ptr<PrototypeAST>> MainLackOfProtos;
 extern bool hasMainFunction;
-Function *getLackFunction(std::string Name);
 //extern void processMain();
 //===----------------------------------------------------------------------===//
 // "Library" functions that can be "extern'd" from user code.
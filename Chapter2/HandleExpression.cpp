@@ -1,5 +1,6 @@
 #pragma once
 #include "Global.h"
+#include "ParseTrace.h"
 /*******************
 *                  *
 ** expression **
@@ -7,185 +8,188 @@
 ********************/
 /// GetTokPrecedence - Get the precedence of the pending binary operator token.
 int GetTokPrecedence() {
-	if (!isascii(CurTok))
-		return -1;
-
-	// Make sure it's a declared binop.
-	int TokPrec = BinopPrecedence[CurTok];
-	if (TokPrec <= 0)
-		return -1;
-	return TokPrec;
-}
-
-//ߺ
-extern void print(std::string str);
-
-//std::unique_ptr<ExprAST> ParseExpression();
-
-/// numberexpr ::= number
-std::unique_ptr<ExprAST> ParseNumberExpr() {
-	auto Result = llvm::make_unique<NumberExprAST>(NumVal);
-	getNextToken(); // consume the number
-    print("number-expression\n");
-	return std::move(Result);
-}
-
-/// parenexpr ::= '(' expression ')'
-std::unique_ptr<ExprAST> ParseParenExpr() {
-	getNextToken(); // eat (.
-	auto V = ParseExpression();
-	if (!V)
-		return nullptr;
-
-	if (CurTok != ')')
-		return LogError("expected ')'");
-	getNextToken(); // eat ).
-	print("paren-expression\n");
-	return V;
+	return BinopPrecedence.getPrecedence(CurTok);
 }
 
-/// minusexpr ::= '-' expression
-std::unique_ptr<ExprAST> ParseMinusExpr() {
-  
-  int BinOp = CurTok;
-  SourceLocation BinLoc = CurLoc;
-  getNextToken(); // eat -.
-
-  auto V = ParseExpression();
-  
-  if (!V)
-    return nullptr;
-
-  auto LHS = llvm::make_unique<NumberExprAST>(0);
-  
-  print("minus-expression\n");
-  return llvm::make_unique<BinaryExprAST>(BinLoc, BinOp, std::move(LHS), std::move(V));
-  
-}
+namespace {
+/// PendingOp - An entry of ParseExpression's operator stack: a prefix or
+/// binary operator still waiting for its right operand, or the opening
+/// bracket of a parenthesized expression, an array index or an argument list.
+struct PendingOp {
+	enum OpKind { Unary, Binary, Paren, Index, Call } Kind;
+	int Op = 0;              // Unary, Binary
+	int Prec = 0;            // Binary
+	SourceLocation Loc = {}; // Binary, Index, Call
+	std::string Name;        // Index, Call
+	size_t FirstArg = 0;     // Call: where its arguments start on the operands
+
+	PendingOp(OpKind Kind) : Kind(Kind) {}
+};
+} // namespace
 
-/// identifierexpr
+/// expression
+///   ::= unary (binop unary)*
+/// unary
+///   ::= op unary
+///   ::= primary
+/// primary
+///   ::= number
+///   ::= '(' expression ')'
 ///   ::= identifier
-///   ::= identifier '(' expression* ')'
-std::unique_ptr<ExprAST> ParseIdentifierExpr() {
-	std::string IdName = IdentifierStr;
-    SourceLocation LitLoc = CurLoc;
-	getNextToken(); // eat identifier.
-
-	if (CurTok != '('){ // Simple variable ref.
-		print("varible-reference-expression\n");
-		return llvm::make_unique<VariableExprAST>(LitLoc, IdName);
-	}
-	// Call.
-	getNextToken(); // eat (
-	std::vector<std::unique_ptr<ExprAST>> Args;
-	if (CurTok != ')') {
-		while (1) {
-			if (auto Arg = ParseExpression())
-				Args.push_back(std::move(Arg));
-			else
-				return nullptr;
-
-			if (CurTok == ')')
-				break;
+///   ::= identifier '[' expression ']'
+///   ::= identifier '(' (expression (',' expression)*)? ')'
+///
+/// Parsed with an operator stack and an operand stack instead of one native
+/// call per nesting level, so machine-generated code nested a million levels
+/// deep parses in linear time and constant native stack.  Binary operators
+/// are reduced Pratt style against the operator table: before an operator is
+/// pushed, the pending ones that bind at least as tightly are reduced, so
+/// operators of equal precedence group to the left ("a - b - c" is
+/// "(a - b) - c").  The trees are exactly those the recursive descent parser
+/// built.
+std::unique_ptr<ExprAST> ParseExpression() {
+	SmallVector<std::unique_ptr<ExprAST>, 16> Operands;
+	SmallVector<PendingOp, 16> Ops;
+
+	auto reduceBinary = [&] {
+		PendingOp &B = Ops.back();
+		auto RHS = std::move(Operands.back());
+		Operands.pop_back();
+		// Operators other than the built-in ones call "binary" + op.
+		if (!strchr("=<+-*/", B.Op))
+			ParsedCallees.push_back(std::string("binary") + (char)B.Op);
+		Operands.back() = llvm::make_unique<BinaryExprAST>(
+			B.Loc, B.Op, std::move(Operands.back()), std::move(RHS));
+		Ops.pop_back();
+	};
 
-			if (CurTok != ',')
-				return LogError("Expected ')' or ',' in argument list");
+	while (1) {
+		// An operand: prefix operators, then a primary.  Any ascii token other
+		// than '(' and ',' is taken for a unary operator.
+		if (isascii(CurTok) && CurTok != '(' && CurTok != ',') {
+			PendingOp U(PendingOp::Unary);
+			U.Op = CurTok;
+			Ops.push_back(std::move(U));
 			getNextToken();
+			continue;
+		}
+		switch (CurTok) {
+		default:
+			return LogError("unknown token when expecting an expression");
+		case INTEGER:
+			Operands.push_back(llvm::make_unique<NumberExprAST>(NumVal));
+			getNextToken(); // consume the number
+			ParseTrace::line("number-expression\n");
+			break;
+		case '(':
+			getNextToken(); // eat (.
+			Ops.push_back(PendingOp(PendingOp::Paren));
+			continue;
+		case VARIABLE: {
+			std::string IdName = CurStr.str();
+			SourceLocation LitLoc = CurLoc;
+			getNextToken(); // eat identifier.
+
+			if (CurTok == '[') { // Array element.
+				getNextToken(); // eat [
+				PendingOp I(PendingOp::Index);
+				I.Loc = LitLoc;
+				I.Name = std::move(IdName);
+				Ops.push_back(std::move(I));
+				continue;
+			}
+			if (CurTok != '(') { // Simple variable ref.
+				ParseTrace::line("varible-reference-expression\n");
+				Operands.push_back(llvm::make_unique<VariableExprAST>(LitLoc, IdName));
+				break;
+			}
+			// Call.
+			getNextToken(); // eat (
+			if (CurTok == ')') {
+				getNextToken(); // eat )
+				ParseTrace::line("call-expression\n");
+				ParsedCallees.push_back(IdName);
+				Operands.push_back(llvm::make_unique<CallExprAST>(
+					LitLoc, IdName, std::vector<std::unique_ptr<ExprAST>>()));
+				break;
+			}
+			PendingOp C(PendingOp::Call);
+			C.Loc = LitLoc;
+			C.Name = std::move(IdName);
+			C.FirstArg = Operands.size();
+			Ops.push_back(std::move(C));
+			continue;
 		}
-	}
-
-	// Eat the ')'.
-	getNextToken();
-	print("call-expression\n");
-	return llvm::make_unique<CallExprAST>(LitLoc, IdName, std::move(Args));
-}
-
-
-/// primary
-///   ::= identifierexpr
-///   ::= numberexpr
-///   ::= parenexpr
-std::unique_ptr<ExprAST> ParsePrimary() {
-	switch (CurTok) {
-	default:
-		return LogError("unknown token when expecting an expression");
-	case VARIABLE:
-		return ParseIdentifierExpr();
-	case INTEGER:
-		return ParseNumberExpr();
-	case '(':
-		return ParseParenExpr();
-    case '-':
-        return ParseMinusExpr();
-	}
-
-}
-
-
-/// Ŀ
-std::unique_ptr<ExprAST> ParseUnary() {
-  // еĿ䰴ͨ
-  if (!isascii(CurTok) || CurTok == '(' || CurTok == ',')
-    return ParsePrimary();
-
-  //еĿȡʣµİΪеĿݹ鴦
-  int Opc = CurTok;
-  getNextToken();
-  if (auto Operand = ParseUnary())
-    return llvm::make_unique<UnaryExprAST>(Opc, std::move(Operand));
-  return nullptr;
-}
-
-
-/// binoprhs
-///   ::= ('+' primary)*
-std::unique_ptr<ExprAST> ParseBinOpRHS(int ExprPrec,
-	std::unique_ptr<ExprAST> LHS) {
-	// If this is a binop, find its precedence.
-	while (1) {
-		int TokPrec = GetTokPrecedence();
-
-		// If this is a binop that binds at least as tightly as the current binop,
-		// consume it, otherwise we are done.
-		if (TokPrec < ExprPrec)
-			return LHS;
-
-		// Okay, we know this is a binop.
-		int BinOp = CurTok;
-        SourceLocation BinLoc = CurLoc;
-		getNextToken(); // eat binop
-
-		// Parse the primary expression after the binary operator.
-		//auto RHS = ParsePrimary();
-        auto RHS = ParseUnary();
-		if (!RHS)
-			return nullptr;
-
-		// If BinOp binds less tightly with RHS than the operator after RHS, let
-		// the pending operator take RHS as its LHS.
-		int NextPrec = GetTokPrecedence();
-		if (TokPrec < NextPrec) {
-			RHS = ParseBinOpRHS(TokPrec + 1, std::move(RHS));
-			if (!RHS)
-				return nullptr;
 		}
 
-		// Merge LHS/RHS.
-		LHS =
-			llvm::make_unique<BinaryExprAST>(BinLoc, BinOp, std::move(LHS), std::move(RHS));
+		// The operand on top is complete.  Loop as long as what follows it
+		// closes brackets, completing the operands they began.
+		while (1) {
+			// Apply the prefix operators in front of it.
+			while (!Ops.empty() && Ops.back().Kind == PendingOp::Unary) {
+				int Opc = Ops.back().Op;
+				Ops.pop_back();
+				ParsedCallees.push_back(std::string("unary") + (char)Opc);
+				Operands.back() =
+					llvm::make_unique<UnaryExprAST>(Opc, std::move(Operands.back()));
+			}
+			if (Ops.empty() || Ops.back().Kind != PendingOp::Binary)
+				ParseTrace::line("binary-expression\n");
+
+			// A binary operator first reduces the pending ones that bind at
+			// least as tightly as it does (all of them associate to the left),
+			// then waits for its right operand.
+			int TokPrec = GetTokPrecedence();
+			if (TokPrec > 0) {
+				while (!Ops.empty() && Ops.back().Kind == PendingOp::Binary &&
+				       Ops.back().Prec >= TokPrec)
+					reduceBinary();
+				PendingOp B(PendingOp::Binary);
+				B.Op = CurTok;
+				B.Prec = TokPrec;
+				B.Loc = CurLoc;
+				Ops.push_back(std::move(B));
+				getNextToken(); // eat binop
+				break;
+			}
+
+			// Anything else ends the innermost expression.
+			while (!Ops.empty() && Ops.back().Kind == PendingOp::Binary)
+				reduceBinary();
+			if (Ops.empty())
+				return std::move(Operands.back());
+
+			PendingOp &G = Ops.back();
+			if (G.Kind == PendingOp::Paren) {
+				if (CurTok != ')')
+					return LogError("expected ')'");
+				getNextToken(); // eat ).
+				ParseTrace::line("paren-expression\n");
+			} else if (G.Kind == PendingOp::Index) {
+				if (CurTok != ']')
+					return LogError("expected ']'");
+				getNextToken(); // eat ]
+				ParseTrace::line("array-index-expression\n");
+				Operands.back() = llvm::make_unique<ArrayIndexExprAST>(
+					G.Loc, G.Name, std::move(Operands.back()));
+			} else {
+				if (CurTok == ',') {
+					getNextToken();
+					break; // the next argument
+				}
+				if (CurTok != ')')
+					return LogError("Expected ')' or ',' in argument list");
+				getNextToken(); // Eat the ')'.
+				std::vector<std::unique_ptr<ExprAST>> Args(
+					std::make_move_iterator(Operands.begin() + G.FirstArg),
+					std::make_move_iterator(Operands.end()));
+				Operands.erase(Operands.begin() + G.FirstArg, Operands.end());
+				ParseTrace::line("call-expression\n");
+				ParsedCallees.push_back(G.Name);
+				Operands.push_back(
+					llvm::make_unique<CallExprAST>(G.Loc, G.Name, std::move(Args)));
+			}
+			Ops.pop_back();
+		}
 	}
 }
-
-
-/// expression
-///   ::= primary binoprhs
-///
-std::unique_ptr<ExprAST> ParseExpression() {
-	//auto LHS = ParsePrimary();
-	auto LHS = ParseUnary();
-	if (!LHS)
-		return nullptr;
-	print("binary-expression\n");
-	return ParseBinOpRHS(0, std::move(LHS));
-}
-
@@ -1,5 +1,14 @@
 #pragma once
+#include "DebugInfo.h"
 #include "Global.h"
+#include "ParseTrace.h"
+#include "Profile.h"
+#include "TimeReport.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 /*******************
  *                  *
  ** function **
@@ -18,7 +27,7 @@ std::unique_ptr<PrototypeAST> ParsePrototype() {
   default:
     return LogErrorP("Expected function name in prototype");
   case VARIABLE: // Ϊ
-    FnName = IdentifierStr;
+    FnName = CurStr.str();
     Kind = 0;
     getNextToken();
     break;
@@ -56,7 +65,7 @@ std::unique_ptr<PrototypeAST> ParsePrototype() {
   std::vector<std::string> ArgNames;
   auto nextToken = getNextToken();
   while (nextToken == VARIABLE) {
-    ArgNames.push_back(IdentifierStr);
+    ArgNames.push_back(CurStr.str());
     nextToken = getNextToken();
     if (nextToken == ',')
       nextToken = getNextToken();
@@ -72,38 +81,310 @@ std::unique_ptr<PrototypeAST> ParsePrototype() {
     return LogErrorP("Invalid number of operands for operator");
 
   return llvm::make_unique<PrototypeAST>(FnName, std::move(ArgNames), Kind != 0,
-                                         BinaryPrecedence);
+                                         BinaryPrecedence, FnLoc);
 }
 
 /// definition ::= 'def' prototype expression
 std::unique_ptr<FunctionAST> ParseDefinition() {
-  outputToTxt("FUNCTION\n");
-  indent = 1;
+  ParseTrace::text("FUNCTION\n");
+  ParseTrace::setDepth(1);
   getNextToken(); // eat FUNC
   auto Proto = ParsePrototype();
   if (!Proto)
     return nullptr;
 
-  if (auto S = ParseStatement())
-    return llvm::make_unique<FunctionAST>(std::move(Proto), std::move(S));
+  ParsedCallees.clear();
+  if (auto S = ParseStatement()) {
+    std::vector<std::string> Callees = std::move(ParsedCallees);
+    std::sort(Callees.begin(), Callees.end());
+    Callees.erase(std::unique(Callees.begin(), Callees.end()), Callees.end());
+    return llvm::make_unique<FunctionAST>(std::move(Proto), std::move(S),
+                                          std::move(Callees));
+  }
 
   return nullptr;
 }
 
+/// FunctionDefs - Definitions parsed so far.  Code generation waits until the
+/// whole input is read, so every call sees its callee's prototype no matter
+/// in which order the functions are defined.  With -stream a definition only
+/// waits here until its callees have prototypes.
+static std::vector<std::unique_ptr<FunctionAST>> FunctionDefs;
+
+/// UserFunctions - Names of all parsed definitions; any other prototype is a
+/// runtime function.
+static std::set<std::string> UserFunctions;
+
+std::unique_ptr<FunctionAST> ParseTopLevelDefinition() {
+  // -cache-dir identifies a definition by its tokens.
+  MD5 Hash;
+  if (!ObjectCacheDir.empty())
+    TokenHash = &Hash;
+  auto FnAST = ParseDefinition();
+  TokenHash = nullptr;
+  if (FnAST && !ObjectCacheDir.empty()) {
+    MD5::MD5Result Result;
+    Hash.final(Result);
+    SmallString<32> Digest;
+    MD5::stringifyResult(Result, Digest);
+    FnAST->setSourceHash(Digest.str().str());
+  }
+  return FnAST;
+}
+
 void HandleDefinition() {
-  if (auto FnAST = ParseDefinition()) {
+  if (auto FnAST = ParseTopLevelDefinition()) {
     // fprintf(stderr, "Parsed a function definition.\n");
     /*outputToTxt("FUNCTION.");*/
-    if (!FnAST->codegen())
-      fprintf(stderr, "Error reading function definition:");
-    else {
-      //if (hasMainFunction && MainLackOfProtos.size() == 0) {
-    //    processMain();
-        //hasMainFunction = false;
-      //}
-    }
+    AddDefinition(std::move(FnAST));
   } else {
     // Skip token for error recovery.
     // getNextToken();
   }
 }
+
+void AddDefinition(std::unique_ptr<FunctionAST> FnAST) {
+  // һ飺ǼǺԭ
+  const PrototypeAST &P = FnAST->getProto();
+  if (FunctionProtos.count(P.getName())) {
+    fprintf(stderr, "Function %s is defined more than once\n",
+            P.getName().c_str());
+    return;
+  }
+  FunctionProtos[P.getName()] = llvm::make_unique<PrototypeAST>(P);
+  UserFunctions.insert(P.getName());
+  // ¶˫Ŀں﷨мʹ
+  if (P.isBinaryOp())
+    BinopPrecedence.add(P.getOperatorName(), P.getBinaryPrecedence());
+  FunctionDefs.push_back(std::move(FnAST));
+}
+
+/// CodegenDefinitions - Second pass: generate code for every parsed
+/// definition, all prototypes being known by now.
+void CodegenDefinitions() {
+  for (auto &FnAST : FunctionDefs) {
+    std::string Name = FnAST->getProto().getName();
+    Function *F;
+    {
+      PhaseTimer T(PhaseCodegen, Name);
+      F = FnAST->codegen();
+    }
+    if (!F) {
+      fprintf(stderr, "Error reading function definition:");
+      continue;
+    }
+    // Run the optimizer on the function.
+    PhaseTimer T(PhaseOptimize, Name);
+    TheFPM->run(*F);
+  }
+  FunctionDefs.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// One module per definition (-stream, -cache-dir)
+//===----------------------------------------------------------------------===//
+
+/// codegenOwnModule - Generate and optimize the code of one definition in a
+/// fresh TheModule.  Returns false on error.
+static bool codegenOwnModule(FunctionAST &FnAST) {
+  std::string Name = FnAST.getProto().getName();
+  InitializeModule();
+  KSDbgInfo.initializeModule();
+  if (ProfileUseEnabled)
+    emitProfileSummary();
+
+  Function *F;
+  {
+    PhaseTimer T(PhaseCodegen, Name);
+    F = FnAST.codegen();
+  }
+  if (!F) {
+    fprintf(stderr, "Error reading function definition:");
+    return false;
+  }
+  {
+    PhaseTimer T(PhaseOptimize, Name);
+    TheFPM->run(*F);
+  }
+  KSDbgInfo.finalize();
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Streaming (-stream)
+//===----------------------------------------------------------------------===//
+
+/// StreamedCallees - The callees of every definition already in the JIT.
+static std::map<std::string, std::vector<std::string>> StreamedCallees;
+
+/// streamDefinition - Hand one definition to the JIT in a module of its own.
+static void streamDefinition(std::unique_ptr<FunctionAST> FnAST) {
+  std::string Name = FnAST->getProto().getName();
+  if (!codegenOwnModule(*FnAST))
+    return;
+
+  PhaseTimer T(PhaseJIT, Name);
+  TheJIT->addModule(std::move(TheModule));
+  StreamedCallees[Name] = FnAST->getCallees();
+}
+
+/// isStreamed - True if Name and everything it calls, transitively, is in the
+/// JIT (runtime functions always are).
+static bool isStreamed(const std::string &Name) {
+  std::set<std::string> Seen;
+  std::vector<const std::string *> Worklist = {&Name};
+  while (!Worklist.empty()) {
+    const std::string &N = *Worklist.back();
+    Worklist.pop_back();
+    if (!Seen.insert(N).second)
+      continue;
+    auto I = StreamedCallees.find(N);
+    if (I == StreamedCallees.end()) {
+      if (UserFunctions.count(N) || !FunctionProtos.count(N))
+        return false;
+      continue;
+    }
+    for (const std::string &Callee : I->second)
+      Worklist.push_back(&Callee);
+  }
+  return true;
+}
+
+bool StreamReadyDefinitions() {
+  // A new definition only adds prototypes, so one pass finds everything it
+  // unblocked.
+  for (auto I = FunctionDefs.begin(); I != FunctionDefs.end();) {
+    const auto &Callees = (*I)->getCallees();
+    bool Ready = std::all_of(Callees.begin(), Callees.end(),
+                             [](const std::string &Callee) {
+                               return FunctionProtos.count(Callee) != 0;
+                             });
+    if (!Ready) {
+      ++I;
+      continue;
+    }
+    streamDefinition(std::move(*I));
+    I = FunctionDefs.erase(I);
+  }
+  return StreamedCallees.count("main") && isStreamed("main");
+}
+
+void reportUnstreamedDefinitions() {
+  for (auto &FnAST : FunctionDefs)
+    for (const std::string &Callee : FnAST->getCallees())
+      if (!FunctionProtos.count(Callee))
+        fprintf(stderr, "Function %s calls undefined function %s\n",
+                FnAST->getProto().getName().c_str(), Callee.c_str());
+  FunctionDefs.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// Object file cache (-cache-dir)
+//===----------------------------------------------------------------------===//
+
+/// Bump when a change to the compiler changes the code it generates.
+static const char CacheFormat[] = "vsl-object-cache-3";
+
+/// cacheKey - Everything the object file of FnAST depends on: its tokens, the
+/// prototypes of its callees (a changed callee body does not matter, calls
+/// are resolved by name when linking) and the compiler options.
+static std::string cacheKey(const FunctionAST &FnAST) {
+  MD5 Hash;
+  auto Bytes = [&Hash](const void *P, size_t N) {
+    Hash.update(ArrayRef<uint8_t>(static_cast<const uint8_t *>(P), N));
+  };
+  auto String = [&Bytes](StringRef S) { Bytes(S.data(), S.size() + 1); };
+
+  String(CacheFormat);
+  String(LLVM_VERSION_STRING);
+  TargetMachine &TM = TheJIT->getTargetMachine();
+  String(TM.getTargetTriple().str());
+  String(TM.getTargetCPU());
+  String(TM.getTargetFeatureString());
+  Bytes(&OptLevel, sizeof(OptLevel));
+  Bytes(&KSDbgInfo.Level, sizeof(KSDbgInfo.Level));
+  String(FnAST.getSourceHash());
+  for (const std::string &Callee : FnAST.getCallees()) {
+    String(Callee);
+    auto I = FunctionProtos.find(Callee);
+    if (I == FunctionProtos.end())
+      continue;
+    const PrototypeAST &P = *I->second;
+    unsigned NumArgs = P.getArgs().size();
+    Bytes(&NumArgs, sizeof(NumArgs));
+    for (unsigned i = 0; i != NumArgs; ++i) {
+      bool IsArray = P.isArrayArg(i);
+      Bytes(&IsArray, sizeof(IsArray));
+    }
+    // The precedence decides how calls to an operator were parsed.
+    unsigned Precedence = P.isBinaryOp() ? P.getBinaryPrecedence() : 0;
+    Bytes(&Precedence, sizeof(Precedence));
+  }
+
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Digest;
+  MD5::stringifyResult(Result, Digest);
+  return Digest.str().str();
+}
+
+/// writeCachedObject - Write Obj to Path through a temporary file, so that a
+/// concurrent or interrupted run never sees half an object file.
+static void writeCachedObject(const std::string &Path, const MemoryBuffer &Obj) {
+  std::string Tmp = Path + ".tmp" + std::to_string(sys::Process::getProcessId());
+  std::error_code EC;
+  {
+    raw_fd_ostream OS(Tmp, EC, sys::fs::F_None);
+    if (EC) {
+      errs() << "Could not write " << Tmp << ": " << EC.message() << "\n";
+      return;
+    }
+    OS << Obj.getBuffer();
+  }
+  if ((EC = sys::fs::rename(Tmp, Path))) {
+    errs() << "Could not write " << Path << ": " << EC.message() << "\n";
+    sys::fs::remove(Tmp);
+  }
+}
+
+void CodegenDefinitionsCached() {
+  // Profiling counters and -profile-use weights are not part of the key.
+  bool UseCache = !ProfilingEnabled && !ProfileUseEnabled;
+  if (!UseCache)
+    fprintf(stderr, "-cache-dir is ignored together with -profile options\n");
+  else if (std::error_code EC = sys::fs::create_directories(ObjectCacheDir)) {
+    errs() << "Could not create " << ObjectCacheDir << ": " << EC.message()
+           << "\n";
+    UseCache = false;
+  }
+
+  unsigned Reused = 0, Compiled = 0;
+  for (auto &FnAST : FunctionDefs) {
+    std::string Name = FnAST->getProto().getName();
+    SmallString<128> Path(ObjectCacheDir);
+    sys::path::append(Path, cacheKey(*FnAST) + ".o");
+
+    if (UseCache) {
+      if (auto Obj = MemoryBuffer::getFile(Path)) {
+        PhaseTimer T(PhaseJIT, Name);
+        TheJIT->addObjectFile(std::move(*Obj));
+        if (Name == "main")
+          hasMainFunction = true;
+        ++Reused;
+        continue;
+      }
+    }
+
+    if (!codegenOwnModule(*FnAST))
+      continue;
+    PhaseTimer T(PhaseJIT, Name);
+    std::unique_ptr<MemoryBuffer> Obj = TheJIT->compileModule(*TheModule);
+    if (UseCache)
+      writeCachedObject(Path.str().str(), *Obj);
+    TheJIT->addObjectFile(std::move(Obj));
+    ++Compiled;
+  }
+  FunctionDefs.clear();
+  TheModule.reset();
+  fprintf(stderr, "object cache: %u reused, %u compiled\n", Reused, Compiled);
+}
@@ -6,13 +6,7 @@
 #pragma once
 #include"AST.h"
 #include"Global.h"
-//ߺ
-void print(std::string str) {//indent
-	for (int i = 0; i < indent; i++) {
-		outputToTxt("\t");
-	}
-	outputToTxt(str);
-}
+#include"ParseTrace.h"
 //¶庯Statement
 //Statement
 std::unique_ptr<StatAST> ParseAssignStat();
@@ -69,7 +63,7 @@ std::unique_ptr<StatAST> ParseStatement() {
 		return LogErrorS("expected identifier after var");
 
 	while (1) {
-		std::string Name = IdentifierStr;
+		std::string Name = CurStr.str();
 		getNextToken(); // eat identifier.
 
 		// ȡܴڵĳʼʽ
@@ -107,43 +101,55 @@ std::unique_ptr<StatAST> ParseStatement() {
 //Assignment Statement
 std::unique_ptr<StatAST> ParseAssignStat() {
     SourceLocation AssignLoc = CurLoc;
-	int indentBefore=indent;
-	print("assignment-stat\n");
-	indent++;
-	print("VARIABLE");
-	std::string Name = IdentifierStr;
+	int indentBefore = ParseTrace::depth();
+	ParseTrace::line("assignment-stat\n");
+	ParseTrace::nest();
+	ParseTrace::line("VARIABLE");
+	std::string Name = CurStr.str();
 	getNextToken();
-	outputToTxt(":=");
+	//Ԫظֵ a[i] := expression
+	std::unique_ptr<ExprAST> Index;
+	if (CurTok == '[') {
+		ParseTrace::text("[index]");
+		getNextToken();
+		Index = ParseExpression();
+		if (!Index)
+			return nullptr;
+		if (CurTok != ']')
+			return LogErrorS("Expected ] in assignment statement");
+		getNextToken();
+	}
+	ParseTrace::text(":=");
 	if (CurTok != ASSIGN_SYMBOL)
 		return LogErrorS("Expected := in assignment statement");
 	getNextToken();
-	outputToTxt("expression\n");
-	indent++;
-	auto Result= llvm::make_unique<AssignStatAST>(AssignLoc,Name, std::move(ParseExpression()));
-	indent =indentBefore;
+	ParseTrace::text("expression\n");
+	ParseTrace::nest();
+	auto Result= llvm::make_unique<AssignStatAST>(AssignLoc,Name, std::move(Index), std::move(ParseExpression()));
+	ParseTrace::setDepth(indentBefore);
 	return std::move(Result);
 }
 //Return Statement
 std::unique_ptr<StatAST> ParseReturnStat() {
      SourceLocation ReturnLoc = CurLoc;
-	int indentBefore = indent;
-	print("return-stat\n");
-	indent++;
-	print("expression\n");
-	indent++;
+	int indentBefore = ParseTrace::depth();
+	ParseTrace::line("return-stat\n");
+	ParseTrace::nest();
+	ParseTrace::line("expression\n");
+	ParseTrace::nest();
 	auto Result = llvm::make_unique<ReturnStatAST>(ReturnLoc, std::move(ParseExpression()));
-	indent = indentBefore;
+	ParseTrace::setDepth(indentBefore);
 	return std::move(Result);
 }
 //Print Statement
 std::unique_ptr<StatAST> ParsePrintStat() {
     SourceLocation PrintLoc = CurLoc;
-	print("print-stat\n");
+	ParseTrace::line("print-stat\n");
 	std::vector<std::unique_ptr<ExprAST>> Texts;
 	/*if (CurTok != TEXT)
 		return LogErrorS("Expected Text in Print statement");*/
 	if (CurTok == TEXT) {
-		Texts.push_back(llvm::make_unique<TextExprAST>(Text));
+		Texts.push_back(llvm::make_unique<TextExprAST>(CurStr.str()));
 		getNextToken();
 	}
 	else {
@@ -152,7 +158,7 @@ std::unique_ptr<StatAST> ParsePrintStat() {
 	while (CurTok == ','){
 		getNextToken();
 		 if (CurTok == TEXT) {
-			 Texts.push_back(llvm::make_unique<TextExprAST>(Text));
+			 Texts.push_back(llvm::make_unique<TextExprAST>(CurStr.str()));
 			 getNextToken();
 		 }
 		 else {
@@ -166,69 +172,69 @@ std::unique_ptr<StatAST> ParsePrintStat() {
 std::unique_ptr<StatAST> ParseIfStat() {
     SourceLocation IfLoc = CurLoc;
     
-	int indentBefore = indent;
-	print("if-stat\n");
-	indent++;
-	print("ifCondition expression\n");
-	indent++;
+	int indentBefore = ParseTrace::depth();
+	ParseTrace::line("if-stat\n");
+	ParseTrace::nest();
+	ParseTrace::line("ifCondition expression\n");
+	ParseTrace::nest();
 	auto IfCondition = std::move(ParseExpression());
-	indent--;
+	ParseTrace::unnest();
 	if (CurTok != THEN) {
 		return LogErrorS("Expected THEN in If statement");
 	}
 	getNextToken();
-	print("THEN statement\n");
-	indent++;
+	ParseTrace::line("THEN statement\n");
+	ParseTrace::nest();
 	auto ThenStat = std::move(ParseStatement());
-	indent--;
+	ParseTrace::unnest();
 	if (CurTok != ELSE) {
 		if (CurTok != FI) {
-			indent = indentBefore;
+			ParseTrace::setDepth(indentBefore);
 			return LogErrorS("Expected FI in If statement");
 		}
 		getNextToken();
-		indent = indentBefore;
+		ParseTrace::setDepth(indentBefore);
 		return llvm::make_unique<IfStatAST>(IfLoc, std::move(IfCondition), std::move(ThenStat));
 	}
-	print("ELSE statement\n");
+	ParseTrace::line("ELSE statement\n");
 	getNextToken();
-	indent++;
+	ParseTrace::nest();
 	std::unique_ptr<StatAST>ElseStat = ParseStatement();
-	indent--;
+	ParseTrace::unnest();
 	if (CurTok != FI) {
-		indent = indentBefore;
+		ParseTrace::setDepth(indentBefore);
 		return LogErrorS("Expected FI in If statement");
 	}
-	print("FI keyword\n");
-	indent = indentBefore;
+	ParseTrace::line("FI keyword\n");
+	ParseTrace::setDepth(indentBefore);
 	getNextToken();
 	return llvm::make_unique<IfStatAST>(IfLoc, std::move(IfCondition), std::move(ThenStat), std::move(ElseStat));
 }
 //While Statement
 std::unique_ptr<StatAST> ParseWhileStat() {
      SourceLocation WhileLoc = CurLoc;
-	int indentBefore = indent;
-	print("while-stat\n");
-	indent++;
-	print("do-condition\n");
-	indent++;
+	int indentBefore = ParseTrace::depth();
+	ParseTrace::line("while-stat\n");
+	ParseTrace::nest();
+	ParseTrace::line("do-condition\n");
+	ParseTrace::nest();
 	auto WhileCondition = std::move(ParseExpression());
-	indent--;
+	ParseTrace::unnest();
 	if (CurTok != DO) {
-		indent = indentBefore;
+		ParseTrace::setDepth(indentBefore);
 		return LogErrorS("Expected DO in While statement");
 	}
-	print("DO statement\n");
+	ParseTrace::line("DO statement\n");
 	getNextToken();
-	indent++;
+	ParseTrace::nest();
 	auto DoStat = std::move(ParseStatement());
-	indent--;
+	ParseTrace::unnest();
 	if (CurTok != DONE) {
-		indent = indentBefore;
+		ParseTrace::setDepth(indentBefore);
 		return LogErrorS("Expected DONE in While statement");
 	}
-	print("DONE keyword\n");
-	indent = indentBefore;
+	ParseTrace::line("DONE keyword\n");
+	ParseTrace::setDepth(indentBefore);
 	getNextToken();
 	Bag * bag = new Bag();
 	//DoStat->parent = bag;
@@ -240,53 +246,65 @@ std::unique_ptr<StatAST> ParseWhileStat() {
 //Block Statement
 std::unique_ptr<StatAST> ParseBlockStat() {
     SourceLocation BlockLoc = CurLoc;
-	int indentBefore = indent;
-	print("block-stat\n");
-	indent++;
+	int indentBefore = ParseTrace::depth();
+	ParseTrace::line("block-stat\n");
+	ParseTrace::nest();
 	//std::vector<VariableExprAST>variables;
 	//std::vector<std::unique_ptr<ExprAST>> variables;
 	std::vector<std::string> variables;
+	std::vector<std::pair<std::string, std::unique_ptr<ExprAST>>> arrays;
 	std::vector<std::unique_ptr<StatAST>> statements;
 	while (CurTok == VAR){
-		print("declaration\n");
+		ParseTrace::line("declaration\n");
 		getNextToken();
 		// Ҫһ
 		if (CurTok != VARIABLE)
 			return LogErrorS("expected identifier after var");
 		do {
-			std::string Name = IdentifierStr;
+			std::string Name = CurStr.str();
 			/*VariableExprAST* ptr = dynamic_cast<VariableExprAST*>(ParseIdentifierExpr().release());
 			variables.push_back(*ptr);*/
 			
-			variables.push_back(Name);
-
 			/*if (auto Arg = ParseIdentifierExpr())
 				variables.push_back(std::move(Arg));*/
 			/*else
 				return nullptr;*/
 			//ؿ 
 			getNextToken();
+			// VAR a[size]
+			if (CurTok == '[') {
+				getNextToken();
+				auto Size = ParseExpression();
+				if (!Size)
+					return nullptr;
+				if (CurTok != ']')
+					return LogErrorS("expected ']' in array declaration");
+				getNextToken();
+				arrays.push_back(std::make_pair(Name, std::move(Size)));
+			}
+			else
+				variables.push_back(Name);
 			if (CurTok != ',')
 				break;
 			getNextToken();
 		} while (CurTok == VARIABLE);
 	}
-	print("statement-list\n");
+	ParseTrace::line("statement-list\n");
 	do {
 		if (CurTok == '}') {
-			indent = indentBefore;
+			ParseTrace::setDepth(indentBefore);
 			getNextToken();
 			return LogErrorS("Expected statement in block statement");
 		}
-		indent++;
+		ParseTrace::nest();
 		if (auto stat = ParseStatement())
 			statements.push_back(std::move(stat));
-		indent--;
+		ParseTrace::unnest();
 		/*else
 			return nullptr;*/
 		//ؿ Ҫ
 	} while (CurTok != '}'&&CurTok!=TOKEOF);
-	indent = indentBefore;
+	ParseTrace::setDepth(indentBefore);
 	getNextToken();
-	return  llvm::make_unique<BlockStatAST>(BlockLoc,std::move(variables), std::move(statements));
+	return  llvm::make_unique<BlockStatAST>(BlockLoc,std::move(variables), std::move(arrays), std::move(statements));
 }
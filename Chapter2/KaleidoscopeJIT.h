@@ -0,0 +1,243 @@
+#pragma once
+#ifndef KALEIDOSCOPEJIT
+#define KALEIDOSCOPEJIT
+//===----------------------------------------------------------------------===//
+// The JIT used by the driver.  It follows LLVM's
+// examples/Kaleidoscope/include/KaleidoscopeJIT.h, and also tells native
+// tools about the code it loads:
+//  - JITEventListeners (GDB registration, perf jitdump) get every object,
+//  - enablePerfMap() writes /tmp/perf-<pid>.map for `perf top`/`perf report`.
+//===----------------------------------------------------------------------===//
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/iterator_range.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace llvm {
+namespace orc {
+
+class KaleidoscopeJIT {
+public:
+  using ObjLayerT = RTDyldObjectLinkingLayer;
+  using CompileLayerT = IRCompileLayer<ObjLayerT, SimpleCompiler>;
+
+  KaleidoscopeJIT()
+      : Resolver(createLegacyLookupResolver(
+            ES,
+            [this](const std::string &Name) {
+              return ObjectLayer.findSymbol(Name, true);
+            },
+            [](Error Err) { cantFail(std::move(Err), "lookupFlags failed"); })),
+        TM(EngineBuilder().selectTarget()), DL(TM->createDataLayout()),
+        ObjectLayer(ES,
+                    [this](VModuleKey) {
+                      return ObjLayerT::Resources{
+                          std::make_shared<SectionMemoryManager>(), Resolver};
+                    },
+                    [this](VModuleKey K, const object::ObjectFile &Obj,
+                           const RuntimeDyld::LoadedObjectInfo &Info) {
+                      notifyObjectLoaded(K, Obj, Info);
+                    },
+                    ObjLayerT::NotifyFinalizedFtor(),
+                    // With this set, the layer keeps each object until it is
+                    // removed instead of freeing it once finalized.
+                    [this](VModuleKey, const object::ObjectFile &Obj) {
+                      notifyFreeingObject(Obj);
+                    }),
+        CompileLayer(ObjectLayer, SimpleCompiler(*TM)) {
+    llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+  }
+
+  ~KaleidoscopeJIT() {
+    // Free the objects while the listeners are still there to hear of it.
+    while (!ModuleKeys.empty())
+      removeModule(ModuleKeys.back());
+  }
+
+  TargetMachine &getTargetMachine() { return *TM; }
+
+  /// registerJITEventListener - Report every object loaded from now on to L.
+  /// A null L (e.g. perf support not built into LLVM) is ignored.
+  void registerJITEventListener(JITEventListener *L) {
+    if (L)
+      Listeners.push_back(L);
+  }
+
+  /// enablePerfMap - Append "start size name" for every JIT-compiled function
+  /// to /tmp/perf-<pid>.map, where perf looks up symbols of anonymous memory.
+  bool enablePerfMap() {
+    std::string Path =
+        "/tmp/perf-" + std::to_string(sys::Process::getProcessId()) + ".map";
+    std::error_code EC;
+    PerfMap = llvm::make_unique<raw_fd_ostream>(Path, EC, sys::fs::F_Append);
+    if (EC) {
+      errs() << "Could not open " << Path << ": " << EC.message() << "\n";
+      PerfMap.reset();
+      return false;
+    }
+    return true;
+  }
+
+  VModuleKey addModule(std::unique_ptr<Module> M) {
+    auto K = ES.allocateVModule();
+    cantFail(CompileLayer.addModule(K, std::move(M)));
+    ModuleKeys.push_back(K);
+    return K;
+  }
+
+  /// compileModule - Compile M to an object file without adding it.
+  std::unique_ptr<MemoryBuffer> compileModule(Module &M) {
+    return SimpleCompiler(*TM)(M);
+  }
+
+  /// addObjectFile - Link an object file, e.g. one compileModule produced in
+  /// an earlier run.  Its key works like a module's.
+  VModuleKey addObjectFile(std::unique_ptr<MemoryBuffer> Obj) {
+    auto K = ES.allocateVModule();
+    cantFail(ObjectLayer.addObject(K, std::move(Obj)));
+    ModuleKeys.push_back(K);
+    return K;
+  }
+
+  void removeModule(VModuleKey K) {
+    ModuleKeys.erase(find(ModuleKeys, K));
+    cantFail(CompileLayer.removeModule(K));
+  }
+
+  JITSymbol findSymbol(const std::string Name) {
+    return findMangledSymbol(mangle(Name));
+  }
+
+private:
+  std::string mangle(const std::string &Name) {
+    std::string MangledName;
+    {
+      raw_string_ostream MangledNameStream(MangledName);
+      Mangler::getNameWithPrefix(MangledNameStream, Name, DL);
+    }
+    return MangledName;
+  }
+
+  JITSymbol findMangledSymbol(const std::string &Name) {
+#ifdef _WIN32
+    // The symbol lookup of ObjectLinkingLayer uses the SymbolRef::SF_Exported
+    // flag to decide whether a symbol will be visible or not, when we call
+    // IRCompileLayer::findSymbolIn with ExportedSymbolsOnly set to true.
+    //
+    // But for Windows COFF objects, this flag is currently never set.
+    // For a workaround, we need to set ExportedSymbolsOnly to false.
+    const bool ExportedSymbolsOnly = false;
+#else
+    const bool ExportedSymbolsOnly = true;
+#endif
+
+    // Search modules in reverse order: from last added to first added.
+    // This is the opposite of the usual search order for dlsym, but makes more
+    // sense in a REPL where we want to bind to the newest available definition.
+    for (auto H : make_range(ModuleKeys.rbegin(), ModuleKeys.rend()))
+      if (auto Sym = CompileLayer.findSymbolIn(H, Name, ExportedSymbolsOnly))
+        return Sym;
+
+    // If we can't find the symbol in the JIT, try looking in the host process.
+    if (auto SymAddr = RTDyldMemoryManager::getSymbolAddressInProcess(Name))
+      return JITSymbol(SymAddr, JITSymbolFlags::Exported);
+
+#ifdef _WIN32
+    // For Windows retry without "_" at beginning, as RTDyldMemoryManager uses
+    // GetProcAddress and standard libraries like msvcrt.dll use names
+    // with and without "_" (for example "_itoa" but "sin").
+    if (Name.length() > 2 && Name[0] == '_')
+      if (auto SymAddr =
+              RTDyldMemoryManager::getSymbolAddressInProcess(Name.substr(1)))
+        return JITSymbol(SymAddr, JITSymbolFlags::Exported);
+#endif
+
+    return nullptr;
+  }
+
+  /// notifyObjectLoaded - Called by the object layer once an object has been
+  /// loaded and relocated.
+  void notifyObjectLoaded(VModuleKey K, const object::ObjectFile &Obj,
+                          const RuntimeDyld::LoadedObjectInfo &Info) {
+    for (JITEventListener *L : Listeners)
+      L->NotifyObjectEmitted(Obj, Info);
+    if (PerfMap)
+      writePerfMap(Obj, Info);
+  }
+
+  /// notifyFreeingObject - Called by the object layer just before it frees
+  /// an object, from removeModule.
+  void notifyFreeingObject(const object::ObjectFile &Obj) {
+    for (JITEventListener *L : Listeners)
+      L->NotifyFreeingObject(Obj);
+  }
+
+  void writePerfMap(const object::ObjectFile &Obj,
+                    const RuntimeDyld::LoadedObjectInfo &Info) {
+    // The debug object has its sections at their load addresses.
+    object::OwningBinary<object::ObjectFile> DebugObj =
+        Info.getObjectForDebug(Obj);
+    if (!DebugObj.getBinary())
+      return;
+    for (const auto &P : object::computeSymbolSizes(*DebugObj.getBinary())) {
+      object::SymbolRef Sym = P.first;
+      Expected<object::SymbolRef::Type> Type = Sym.getType();
+      if (!Type) {
+        consumeError(Type.takeError());
+        continue;
+      }
+      if (*Type != object::SymbolRef::ST_Function)
+        continue;
+      Expected<StringRef> Name = Sym.getName();
+      Expected<uint64_t> Addr = Sym.getAddress();
+      if (!Name || !Addr) {
+        if (!Name)
+          consumeError(Name.takeError());
+        if (!Addr)
+          consumeError(Addr.takeError());
+        continue;
+      }
+      *PerfMap << format("%llx %llx ", (unsigned long long)*Addr,
+                         (unsigned long long)P.second)
+               << *Name << "\n";
+    }
+    PerfMap->flush();
+  }
+
+  ExecutionSession ES;
+  std::shared_ptr<SymbolResolver> Resolver;
+  std::unique_ptr<TargetMachine> TM;
+  const DataLayout DL;
+  ObjLayerT ObjectLayer;
+  CompileLayerT CompileLayer;
+  std::vector<VModuleKey> ModuleKeys;
+
+  std::vector<JITEventListener *> Listeners;
+  std::unique_ptr<raw_fd_ostream> PerfMap;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // !KALEIDOSCOPEJIT
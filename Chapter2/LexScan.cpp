@@ -0,0 +1,268 @@
+#include "LexScan.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define VSL_SCAN_SSE2 1
+// AVX2 code is compiled for its own functions only and picked at run time,
+// so the compiler itself still runs on any x86-64.
+#if defined(__GNUC__)
+#define VSL_SCAN_AVX2 1
+#define VSL_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+#endif
+
+//===----------------------------------------------------------------------===//
+// Scalar
+//===----------------------------------------------------------------------===//
+
+static bool isBlank(char C) { return C == ' ' || C == '\t' || C == '\n'; }
+static bool isLineBreak(char C) { return C == '\n' || C == '\r'; }
+
+static const char *skipWhitespaceScalar(const char *P, const char *End) {
+	while (P != End && isBlank(*P))
+		++P;
+	return P;
+}
+
+static const char *findQuoteOrBackslashScalar(const char *P, const char *End) {
+	while (P != End && *P != '"' && *P != '\\')
+		++P;
+	return P;
+}
+
+static const char *findLineBreakScalar(const char *P, const char *End) {
+	while (P != End && !isLineBreak(*P))
+		++P;
+	return P;
+}
+
+static size_t countLineBreaksScalar(const char *P, const char *End) {
+	size_t N = 0;
+	for (; P != End; ++P)
+		N += isLineBreak(*P);
+	return N;
+}
+
+//===----------------------------------------------------------------------===//
+// SSE2: 16 bytes at a time
+//===----------------------------------------------------------------------===//
+
+#ifdef VSL_SCAN_SSE2
+static unsigned firstSet(unsigned Mask) {
+#ifdef _MSC_VER
+	unsigned long I;
+	_BitScanForward(&I, Mask);
+	return I;
+#else
+	return __builtin_ctz(Mask);
+#endif
+}
+
+static const char *skipWhitespaceSSE2(const char *P, const char *End) {
+	const __m128i Space = _mm_set1_epi8(' '), Tab = _mm_set1_epi8('\t'),
+	              NL = _mm_set1_epi8('\n');
+	for (; End - P >= 16; P += 16) {
+		__m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(P));
+		__m128i Blank = _mm_or_si128(
+		    _mm_or_si128(_mm_cmpeq_epi8(V, Space), _mm_cmpeq_epi8(V, Tab)),
+		    _mm_cmpeq_epi8(V, NL));
+		if (unsigned Other = ~_mm_movemask_epi8(Blank) & 0xFFFF)
+			return P + firstSet(Other);
+	}
+	return skipWhitespaceScalar(P, End);
+}
+
+static const char *findQuoteOrBackslashSSE2(const char *P, const char *End) {
+	const __m128i Quote = _mm_set1_epi8('"'), Backslash = _mm_set1_epi8('\\');
+	for (; End - P >= 16; P += 16) {
+		__m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(P));
+		__m128i Hit = _mm_or_si128(_mm_cmpeq_epi8(V, Quote),
+		                           _mm_cmpeq_epi8(V, Backslash));
+		if (unsigned Mask = _mm_movemask_epi8(Hit))
+			return P + firstSet(Mask);
+	}
+	return findQuoteOrBackslashScalar(P, End);
+}
+
+static const char *findLineBreakSSE2(const char *P, const char *End) {
+	const __m128i NL = _mm_set1_epi8('\n'), CR = _mm_set1_epi8('\r');
+	for (; End - P >= 16; P += 16) {
+		__m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(P));
+		__m128i Hit = _mm_or_si128(_mm_cmpeq_epi8(V, NL), _mm_cmpeq_epi8(V, CR));
+		if (unsigned Mask = _mm_movemask_epi8(Hit))
+			return P + firstSet(Mask);
+	}
+	return findLineBreakScalar(P, End);
+}
+
+/// countLineBreaksSSE2 - Without a popcount instruction to rely on, the
+/// matches (-1 per byte) are summed per byte lane, up to 255 blocks, then
+/// across the lanes with psadbw.
+static size_t countLineBreaksSSE2(const char *P, const char *End) {
+	const __m128i NL = _mm_set1_epi8('\n'), CR = _mm_set1_epi8('\r');
+	size_t N = 0;
+	while (End - P >= 16) {
+		size_t Blocks = std::min<size_t>((End - P) / 16, 255);
+		__m128i Counts = _mm_setzero_si128();
+		for (size_t I = 0; I != Blocks; ++I, P += 16) {
+			__m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(P));
+			Counts = _mm_sub_epi8(Counts, _mm_or_si128(_mm_cmpeq_epi8(V, NL),
+			                                           _mm_cmpeq_epi8(V, CR)));
+		}
+		__m128i Sums = _mm_sad_epu8(Counts, _mm_setzero_si128());
+		N += _mm_cvtsi128_si32(Sums) + _mm_extract_epi16(Sums, 4);
+	}
+	return N + countLineBreaksScalar(P, End);
+}
+#endif
+
+//===----------------------------------------------------------------------===//
+// AVX2: 32 bytes at a time
+//===----------------------------------------------------------------------===//
+
+#ifdef VSL_SCAN_AVX2
+VSL_TARGET_AVX2
+static const char *skipWhitespaceAVX2(const char *P, const char *End) {
+	const __m256i Space = _mm256_set1_epi8(' '), Tab = _mm256_set1_epi8('\t'),
+	              NL = _mm256_set1_epi8('\n');
+	for (; End - P >= 32; P += 32) {
+		__m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(P));
+		__m256i Blank = _mm256_or_si256(
+		    _mm256_or_si256(_mm256_cmpeq_epi8(V, Space), _mm256_cmpeq_epi8(V, Tab)),
+		    _mm256_cmpeq_epi8(V, NL));
+		if (unsigned Other = ~(unsigned)_mm256_movemask_epi8(Blank))
+			return P + __builtin_ctz(Other);
+	}
+	return skipWhitespaceSSE2(P, End);
+}
+
+VSL_TARGET_AVX2
+static const char *findQuoteOrBackslashAVX2(const char *P, const char *End) {
+	const __m256i Quote = _mm256_set1_epi8('"'),
+	              Backslash = _mm256_set1_epi8('\\');
+	for (; End - P >= 32; P += 32) {
+		__m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(P));
+		__m256i Hit = _mm256_or_si256(_mm256_cmpeq_epi8(V, Quote),
+		                              _mm256_cmpeq_epi8(V, Backslash));
+		if (unsigned Mask = (unsigned)_mm256_movemask_epi8(Hit))
+			return P + __builtin_ctz(Mask);
+	}
+	return findQuoteOrBackslashSSE2(P, End);
+}
+
+VSL_TARGET_AVX2
+static const char *findLineBreakAVX2(const char *P, const char *End) {
+	const __m256i NL = _mm256_set1_epi8('\n'), CR = _mm256_set1_epi8('\r');
+	for (; End - P >= 32; P += 32) {
+		__m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(P));
+		__m256i Hit = _mm256_or_si256(_mm256_cmpeq_epi8(V, NL),
+		                              _mm256_cmpeq_epi8(V, CR));
+		if (unsigned Mask = (unsigned)_mm256_movemask_epi8(Hit))
+			return P + __builtin_ctz(Mask);
+	}
+	return findLineBreakSSE2(P, End);
+}
+
+VSL_TARGET_AVX2
+static size_t countLineBreaksAVX2(const char *P, const char *End) {
+	const __m256i NL = _mm256_set1_epi8('\n'), CR = _mm256_set1_epi8('\r');
+	size_t N = 0;
+	for (; End - P >= 32; P += 32) {
+		__m256i V = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(P));
+		__m256i Hit = _mm256_or_si256(_mm256_cmpeq_epi8(V, NL),
+		                              _mm256_cmpeq_epi8(V, CR));
+		N += __builtin_popcount((unsigned)_mm256_movemask_epi8(Hit));
+	}
+	return N + countLineBreaksScalar(P, End);
+}
+#endif
+
+//===----------------------------------------------------------------------===//
+// Dispatch
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct ScanKernels {
+	const char *(*SkipWhitespace)(const char *, const char *);
+	const char *(*FindQuoteOrBackslash)(const char *, const char *);
+	const char *(*FindLineBreak)(const char *, const char *);
+	size_t (*CountLineBreaks)(const char *, const char *);
+};
+} // namespace
+
+static const ScanKernels Kernels[] = {
+	{skipWhitespaceScalar, findQuoteOrBackslashScalar, findLineBreakScalar,
+	 countLineBreaksScalar},
+#ifdef VSL_SCAN_SSE2
+	{skipWhitespaceSSE2, findQuoteOrBackslashSSE2, findLineBreakSSE2,
+	 countLineBreaksSSE2},
+#else
+	{skipWhitespaceScalar, findQuoteOrBackslashScalar, findLineBreakScalar,
+	 countLineBreaksScalar},
+#endif
+#ifdef VSL_SCAN_AVX2
+	{skipWhitespaceAVX2, findQuoteOrBackslashAVX2, findLineBreakAVX2,
+	 countLineBreaksAVX2},
+#else
+	{nullptr, nullptr, nullptr, nullptr},
+#endif
+};
+
+static ScanISA bestScanISA() {
+#ifdef VSL_SCAN_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return ScanAVX2;
+#endif
+#ifdef VSL_SCAN_SSE2
+	return ScanSSE2;
+#else
+	return ScanScalar;
+#endif
+}
+
+static ScanISA CurrentISA = bestScanISA();
+static const ScanKernels *Current = &Kernels[CurrentISA];
+
+const char *skipWhitespace(const char *P, const char *End) {
+	return Current->SkipWhitespace(P, End);
+}
+
+const char *findQuoteOrBackslash(const char *P, const char *End) {
+	return Current->FindQuoteOrBackslash(P, End);
+}
+
+const char *findNewline(const char *P, const char *End) {
+	// The C library's memchr is vectorized already.
+	const void *NL = memchr(P, '\n', End - P);
+	return NL ? static_cast<const char *>(NL) : End;
+}
+
+const char *findLineBreak(const char *P, const char *End) {
+	return Current->FindLineBreak(P, End);
+}
+
+size_t countLineBreaks(const char *P, const char *End) {
+	return Current->CountLineBreaks(P, End);
+}
+
+ScanISA getScanISA() { return CurrentISA; }
+
+void setScanISA(ScanISA ISA) {
+	CurrentISA = std::min(ISA, bestScanISA());
+	Current = &Kernels[CurrentISA];
+}
+
+const char *getScanISAName(ScanISA ISA) {
+	switch (ISA) {
+	case ScanScalar:
+		return "scalar";
+	case ScanSSE2:
+		return "sse2";
+	case ScanAVX2:
+		return "avx2";
+	}
+	return "unknown";
+}
@@ -0,0 +1,37 @@
+#pragma once
+#ifndef LEXSCAN
+#define LEXSCAN
+#include <cstddef>
+
+//===----------------------------------------------------------------------===//
+// Lexer scanning kernels: the byte runs gettok skips, 16 or 32 bytes at a time
+//===----------------------------------------------------------------------===//
+
+/// ScanISA - Instruction sets the kernels are written for.  The best one the
+/// CPU supports is picked at startup.
+enum ScanISA {
+	ScanScalar,
+	ScanSSE2,
+	ScanAVX2,
+};
+
+/// skipWhitespace - The first byte in [P, End) that recWhitespace rejects, or
+/// End.
+const char *skipWhitespace(const char *P, const char *End);
+/// findQuoteOrBackslash - The first '"' or '\\' in [P, End), or End.
+const char *findQuoteOrBackslash(const char *P, const char *End);
+/// findNewline - The first '\n' in [P, End), or End.
+const char *findNewline(const char *P, const char *End);
+/// findLineBreak - The first '\n' or '\r' in [P, End), or End.
+const char *findLineBreak(const char *P, const char *End);
+/// countLineBreaks - The number of '\n' and '\r' in [P, End): the lines
+/// started while consuming it.
+size_t countLineBreaks(const char *P, const char *End);
+
+/// getScanISA/setScanISA - The kernels in use.  setScanISA falls back to the
+/// best supported set below ISA; it is meant for benchmarks and tests.
+ScanISA getScanISA();
+void setScanISA(ScanISA ISA);
+const char *getScanISAName(ScanISA ISA);
+
+#endif // !LEXSCAN
@@ -2,10 +2,13 @@
 #ifndef LEXER
 #define LEXER
 #include "Global.h"
+#include "LexScan.h"
+#include "TokenBuffer.h"
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
-#include <regex>
 
 using namespace std;
 //===----------------------------------------------------------------------===//
@@ -52,37 +55,107 @@ int recKeyword() {
 	return Token();
 }
 
+thread_local SourceLocation CurLoc;
+LineTable SourceLines;
+
+void LineTable::reset(const char *Begin, const char *End) {
+  LineStarts.clear();
+  LineStarts.reserve(countLineBreaks(Begin, End) + 1);
+  LineStarts.push_back(0);
+  for (const char *P = Begin; (P = findLineBreak(P, End)) != End; ++P)
+    LineStarts.push_back(P + 1 - Begin);
+}
+
+LineCol LineTable::getLineCol(SourceLocation Loc) const {
+  size_t Line = std::upper_bound(LineStarts.begin(), LineStarts.end(),
+                                 Loc.Offset) -
+                LineStarts.begin();
+  if (Line < LineStarts.size() && LineStarts[Line] == Loc.Offset + 1)
+    return {(int)Line + 1, 0};
+  return {(int)Line, (int)(Loc.Offset - LineStarts[Line - 1]) + 1};
+}
+
+/// BufferCur/BufferEnd - The in-memory input installed by setLexerBuffer;
+/// null while reading standard input.
+static thread_local const char *BufferBegin = nullptr;
+static thread_local const char *BufferCur = nullptr;
+static thread_local const char *BufferEnd = nullptr;
+/// BaseOffset - Input offset of BufferBegin.
+static thread_local uint32_t BaseOffset = 0;
+/// StdinOffset - Characters read from standard input so far.
+static thread_local uint32_t StdinOffset = 0;
+/// LastChar - The character after the last token returned by gettok.
+static thread_local int LastChar = ' ';
+/// TokenStart - Buffer offset of the last token, taken together with CurLoc.
+static thread_local size_t TokenStart = 0;
+
+void setLexerBuffer(const char *Begin, const char *End) {
+  SourceLines.reset(Begin, End);
+  setLexerBuffer(Begin, End, 0);
+}
+
+void setLexerBuffer(const char *Begin, const char *End, uint32_t Offset) {
+  BufferBegin = BufferCur = Begin;
+  BufferEnd = End;
+  BaseOffset = Offset;
+  LastChar = ' ';
+  PreLexed = nullptr;
+}
+
+/// lastCharOffset - Buffer offset of LastChar (the end of the input at EOF).
+static size_t lastCharOffset() {
+  if (!BufferCur)
+    return LastChar == EOF ? StdinOffset : StdinOffset - 1;
+  if (LastChar == EOF)
+    return BufferEnd - BufferBegin;
+  return BufferCur - BufferBegin - 1;
+}
+
+void getTokenRange(uint32_t &Offset, uint32_t &Length) {
+  Offset = TokenStart;
+  Length = lastCharOffset() - TokenStart;
+}
+
 int advance() {
-  int LastChar = getchar();
-
-  if (LastChar == '\n' || LastChar == '\r') {
-    LexLoc.Line++;
-    LexLoc.Col = 0;
-  } else
-    LexLoc.Col++;
-  return LastChar;
+  if (BufferCur)
+    return BufferCur != BufferEnd ? (unsigned char)*BufferCur++ : EOF;
+
+  // Standard input cannot be scanned for its lines up front; they are noted
+  // as they are read.
+  int C = getchar();
+  if (C == EOF)
+    return C;
+  ++StdinOffset;
+  if (C == '\n' || C == '\r')
+    SourceLines.addLineStart(StdinOffset);
+  return C;
 }
-/// gettok - Return the next token from standard input.
+
+/// gettok - Return the next token from standard input, or from the buffer
+/// given to setLexerBuffer.
 int gettok() {
-	static int LastChar = ' ';
 	IdentifierStr = "";
 	NumVal = 0;
 	Text = "";
-	//识别分隔符并跳过
-	while (recWhitespace(LastChar)) {
-		LastChar = advance();
-	}
-    CurLoc = LexLoc;
-	//蔵detify comment
-	if (LastChar == '/') {
+	//识别分隔符和注释并跳过，注释之后可能还有空白或下一行注释
+	for (;;) {
+		while (recWhitespace(LastChar)) {
+			if (BufferCur)
+				BufferCur = skipWhitespace(BufferCur, BufferEnd);
+			LastChar = advance();
+		}
+		TokenStart = lastCharOffset();
+		CurLoc = {BaseOffset + (uint32_t)TokenStart};
+		if (LastChar != '/')
+			break;
 		LastChar = advance();
-		if (LastChar == '/') {
-			while (LastChar != '\n')
-				LastChar = advance();
+		if (LastChar != '/')
+			return '/';
+		while (LastChar != '\n' && LastChar != EOF) {
+			if (BufferCur)
+				BufferCur = findNewline(BufferCur, BufferEnd);
 			LastChar = advance();
 		}
-          else
-            return '/';
 	}
 	//识别标识符
 	if (isalpha(LastChar)) {
@@ -103,12 +176,16 @@ int gettok() {
 			LastChar = advance();
 		} while (isdigit(LastChar) || LastChar == '.');
 
-		std::regex re("(.+\..+){2,}");
-		if (regex_match(NumStr, re)) {
-			cout << "invalid input:" << NumStr << endl;
+		// This used to be regex_match(NumStr, std::regex("(.+\..+){2,}")), but
+		// "\." in a string literal is just '.', so it matched exactly the
+		// literals of 6 or more characters.  VSL integers are 32-bit: reject
+		// only the literals that do not fit.
+		double Val = strtod(NumStr.c_str(), 0);
+		if (Val > INT32_MAX) {
+			cerr << "invalid input:" << NumStr << endl;
 			return 0;
 		}
-		NumVal = strtod(NumStr.c_str(), 0);
+		NumVal = (int)Val;
 		return INTEGER;
 	}
 	//识别text
@@ -125,6 +202,11 @@ int gettok() {
                       LastChar = '\\';
 			}
 			Text += LastChar;
+			if (BufferCur) {
+				const char *P = findQuoteOrBackslash(BufferCur, BufferEnd);
+				Text.append(BufferCur, P);
+				BufferCur = P;
+			}
 			LastChar = advance();
 		}
         LastChar = advance();
@@ -0,0 +1,195 @@
+#include "ParallelParse.h"
+#include "Global.h"
+#include "TimeReport.h"
+#include "TokenBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <thread>
+
+//===----------------------------------------------------------------------===//
+// Definition boundaries
+//===----------------------------------------------------------------------===//
+
+/// skipBlanks - Past the spaces and tabs at P, as gettok skips them.
+static const char *skipBlanks(const char *P, const char *End) {
+	while (P != End && (*P == ' ' || *P == '\t'))
+		++P;
+	return P;
+}
+
+/// isFuncKeyword - Whether a FUNC token starts at P.
+static bool isFuncKeyword(const char *P, const char *End) {
+	return End - P >= 4 && !memcmp(P, "FUNC", 4) &&
+	       (End - P == 4 || !isalnum((unsigned char)P[4]));
+}
+
+std::vector<DefinitionStart> findDefinitionStarts(const char *Begin,
+                                                  const char *End) {
+	// Only what changes how gettok splits the bytes matters here: text
+	// literals, comments, and ':', which takes the next character along when it
+	// is not ":=".  At the start of any other line gettok is between two tokens.
+	// After a comment it goes on with the next character without skipping
+	// blanks or looking for another comment, so that line is never a start.
+	std::vector<DefinitionStart> Starts;
+	bool LineStart = true;
+	const char *P = Begin;
+	while (P != End) {
+		if (LineStart) {
+			LineStart = false;
+			const char *Tok = skipBlanks(P, End);
+			if (isFuncKeyword(Tok, End))
+				Starts.push_back({(uint32_t)(P - Begin)});
+			P = Tok;
+			continue;
+		}
+		char C = *P++;
+		switch (C) {
+		case '\n':
+		case '\r':
+			LineStart = true;
+			break;
+		case ':':
+			if (P == End)
+				break;
+			if (*P == '\n' || *P == '\r')
+				LineStart = true;
+			++P;
+			break;
+		case '"':
+			while (P != End && *P != '"') {
+				if (*P == '\\' && ++P == End)
+					break;
+				++P;
+			}
+			if (P != End)
+				++P;
+			break;
+		case '/': {
+			if (P == End || *P != '/')
+				break;
+			const char *NL = (const char *)memchr(P, '\n', End - P);
+			if (!NL)
+				NL = End;
+			P = NL;
+			if (P == End)
+				break;
+			++P;
+			// The character after the comment is a token of its own if it is
+			// a '/'.
+			if (P != End && *P == '/')
+				++P;
+			break;
+		}
+		}
+	}
+	return Starts;
+}
+
+//===----------------------------------------------------------------------===//
+// Parsing runs of definitions
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// ParseChunk - Consecutive definitions parsed by one task.
+struct ParseChunk {
+	const char *Begin, *End; // End is just past the next chunk's FUNC
+	uint32_t BaseOffset; // of Begin in the input
+	bool Last;
+	std::vector<std::unique_ptr<FunctionAST>> Defs;
+	bool Stopped = false; // MainLoop would stop here: not at a FUNC
+	bool Serial = false;  // only the serial parse gets this one right
+	std::chrono::steady_clock::duration LexTime{};
+};
+} // namespace
+
+/// parseChunk - Parse Chunk as MainLoop would, stopping at the FUNC that
+/// begins the next chunk.
+static void parseChunk(ParseChunk &Chunk) {
+	TokenBuffer Tokens;
+	auto Start = std::chrono::steady_clock::now();
+	preLex(Tokens, Chunk.Begin, Chunk.End, Chunk.BaseOffset);
+	Chunk.LexTime = std::chrono::steady_clock::now() - Start;
+
+	// The parser sees the same tokens as in the whole input up to and
+	// including the next chunk's FUNC, there TOKEOF.
+	size_t Boundary = Tokens.size() - (Chunk.Last ? 1 : 2);
+	getNextToken();
+	while (PreLexedPos < Boundary) {
+		if (CurTok != FUNC) {
+			Chunk.Stopped = true;
+			return;
+		}
+		auto FnAST = ParseTopLevelDefinition();
+		if (!FnAST)
+			continue;
+		// Later definitions must see the new operator's precedence.
+		if (FnAST->getProto().isBinaryOp()) {
+			Chunk.Serial = true;
+			return;
+		}
+		Chunk.Defs.push_back(std::move(FnAST));
+	}
+	// A definition that ran into the next chunk.
+	if (PreLexedPos != Boundary)
+		Chunk.Serial = true;
+}
+
+bool ParseDefinitionsParallel(const char *Begin, const char *End,
+                              unsigned Threads) {
+	if (!Threads)
+		Threads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<DefinitionStart> Starts = findDefinitionStarts(Begin, End);
+	if (Threads < 2 || Starts.size() < 2)
+		return false;
+	// The workers only read it.
+	SourceLines.reset(Begin, End);
+
+	// A few chunks per thread, of about the same size, so the threads finish
+	// together even when the definitions' sizes differ.
+	size_t NumChunks = std::min<size_t>(Starts.size(), Threads * 8);
+	size_t Size = End - Begin;
+	std::vector<ParseChunk> Chunks;
+	Chunks.push_back({Begin, End, 0, true});
+	for (const DefinitionStart &S : Starts) {
+		if (S.Offset == 0 || S.Offset < Chunks.size() * Size / NumChunks)
+			continue;
+		const char *Func = skipBlanks(Begin + S.Offset, End);
+		Chunks.back().End = Func + 4;
+		Chunks.back().Last = false;
+		Chunks.push_back({Begin + S.Offset, End, S.Offset, true});
+	}
+
+	std::atomic<size_t> Next(0);
+	auto Work = [&] {
+		for (size_t I; (I = Next++) < Chunks.size();)
+			parseChunk(Chunks[I]);
+	};
+	std::vector<std::thread> Workers;
+	for (unsigned T = 1; T < std::min<size_t>(Threads, Chunks.size()); ++T)
+		Workers.emplace_back(Work);
+	Work();
+	for (std::thread &W : Workers)
+		W.join();
+	PreLexed = nullptr;
+
+	for (ParseChunk &Chunk : Chunks) {
+		if (Chunk.Serial)
+			return false;
+		if (Chunk.Stopped)
+			break;
+	}
+	// Merge in source order, so duplicate definitions are reported and
+	// resolved as they would be by MainLoop.
+	for (ParseChunk &Chunk : Chunks) {
+		if (TimePhasesEnabled)
+			LexWallTime += Chunk.LexTime;
+		for (auto &FnAST : Chunk.Defs)
+			AddDefinition(std::move(FnAST));
+		if (Chunk.Stopped)
+			break;
+	}
+	CurTok = TOKEOF;
+	return true;
+}
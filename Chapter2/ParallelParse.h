@@ -0,0 +1,34 @@
+#pragma once
+#ifndef PARALLELPARSE
+#define PARALLELPARSE
+#include <cstdint>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Parallel parsing: the input split at top-level FUNCs
+//===----------------------------------------------------------------------===//
+
+/// DefinitionStart - A line that starts with FUNC outside any text literal or
+/// comment, where the lexer is between two tokens.
+struct DefinitionStart {
+	uint32_t Offset; // of the first byte of the line
+};
+
+/// findDefinitionStarts - The lines of [Begin, End) a definition can be parsed
+/// from independently of everything before it.  Lexing the input from any of
+/// them, at the same base offset, gives the same tokens and locations as lexing
+/// all of it.
+std::vector<DefinitionStart> findDefinitionStarts(const char *Begin,
+                                                  const char *End);
+
+/// ParseDefinitionsParallel - Parse [Begin, End) on Threads threads (0: one per
+/// core), each lexing and parsing runs of definitions between two starts, and
+/// hand the definitions to AddDefinition in source order.  SourceLines is
+/// reset to the input's lines first.  Returns false,
+/// having added nothing, if the input needs the serial parse: a parse error
+/// (so its recovery and diagnostics stay exactly the same) or a binary
+/// operator definition, which changes how the definitions after it parse.
+bool ParseDefinitionsParallel(const char *Begin, const char *End,
+                              unsigned Threads);
+
+#endif // !PARALLELPARSE
@@ -0,0 +1,24 @@
+#include "ParseTrace.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+thread_local int ParseTracer<true>::Depth = 0;
+
+/// getTraceStream - output.txt, truncated and opened on the first write and
+/// flushed when the compiler exits.
+static raw_ostream &getTraceStream() {
+	static std::error_code EC;
+	static raw_fd_ostream OS("output.txt", EC, sys::fs::F_None);
+	return OS;
+}
+
+void ParseTracer<true>::line(const char *Str) {
+	raw_ostream &OS = getTraceStream();
+	for (int i = 0; i < Depth; ++i)
+		OS << '\t';
+	OS << Str;
+}
+
+void ParseTracer<true>::text(const char *Str) { getTraceStream() << Str; }
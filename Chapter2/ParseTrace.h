@@ -0,0 +1,43 @@
+#pragma once
+#ifndef PARSETRACE
+#define PARSETRACE
+
+//===----------------------------------------------------------------------===//
+// Parser trace: what the parser recognized, written to output.txt
+//===----------------------------------------------------------------------===//
+
+/// VSL_PARSE_TRACE - Build with the trace (cmake -DVSL_PARSE_TRACE=ON).  Off,
+/// the calls below are empty inline functions and no code is left of them.
+#ifndef VSL_PARSE_TRACE
+#define VSL_PARSE_TRACE 0
+#endif
+
+/// ParseTracer - line() writes its text at the current depth, one tab per
+/// level; text() writes it as is.  Depth is per thread, like the parser's
+/// state.
+template <bool Enable> struct ParseTracer {
+	static constexpr bool Enabled = false;
+	static void line(const char *) {}
+	static void text(const char *) {}
+	static int depth() { return 0; }
+	static void setDepth(int) {}
+	static void nest() {}
+	static void unnest() {}
+};
+
+template <> struct ParseTracer<true> {
+	static constexpr bool Enabled = true;
+	static void line(const char *Str);
+	static void text(const char *Str);
+	static int depth() { return Depth; }
+	static void setDepth(int D) { Depth = D; }
+	static void nest() { ++Depth; }
+	static void unnest() { --Depth; }
+
+private:
+	static thread_local int Depth;
+};
+
+using ParseTrace = ParseTracer<VSL_PARSE_TRACE != 0>;
+
+#endif // !PARSETRACE
@@ -1,21 +1,7 @@
 #pragma once
 #include "Global.h"
 //bool isMain = false;
-std::map<std::string, std::unique_ptr<PrototypeAST>> MainLackOfProtos;
 bool hasMainFunction=false;
-Function *getLackFunction(std::string Name) {
-	// First, see if the function has already been added to the current module.
-	if (auto *F = TheModule->getFunction(Name))
-		return F;
-	// If not, check whether we can codegen the declaration from some existing
-	// prototype.
-	auto FI = MainLackOfProtos.find(Name);
-	if (FI != MainLackOfProtos.end())
-		return FI->second->codegen();
-
-	// If no existing prototype exists, return null.
-	return nullptr;
-}
  void processMain(){
 			 // JIT the module containing the anonymous expression, keeping a handle so
 			 // we can free it later.
@@ -0,0 +1,175 @@
+#include "Profile.h"
+#include "Global.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/ProfileSummary.h"
+#include "llvm/ProfileData/ProfileCommon.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+
+using namespace llvm;
+
+bool ProfilingEnabled = false;
+std::vector<ProfileSite> ProfileSites;
+bool ProfileUseEnabled = false;
+/// ProfileCounts - The loaded profile, keyed by getSiteKey.
+static StringMap<uint64_t> ProfileCounts;
+
+static const char *const KindNames[] = {
+	"entry", "while", "while-enter", "while-run", "then", "else"
+};
+
+static const char *getKindName(ProfileSiteKind Kind) {
+	return KindNames[Kind];
+}
+
+static std::string getSiteKey(StringRef Function, StringRef Kind, int Line,
+                              int Col) {
+	return (Function + " " + Kind + " " + Twine(Line) + " " + Twine(Col)).str();
+}
+
+void emitProfileCounter(ProfileSiteKind Kind, StringRef Function, int Line,
+                        int Col) {
+	std::string Name = "__vsl_prof." + std::to_string(ProfileSites.size());
+	Type *Int64Ty = Type::getInt64Ty(TheContext);
+	auto *Counter = new GlobalVariable(*TheModule, Int64Ty, false,
+		GlobalValue::ExternalLinkage, ConstantInt::get(Int64Ty, 0), Name);
+	Value *Old = Builder.CreateLoad(Counter, "prof");
+	Builder.CreateStore(Builder.CreateAdd(Old, Builder.getInt64(1)), Counter);
+	ProfileSites.push_back(ProfileSite{ Kind, Function, Line, Col, Name, 0 });
+}
+
+void readProfileCounters() {
+	for (ProfileSite &Site : ProfileSites) {
+		auto Symbol = TheJIT->findSymbol(Site.Counter);
+		if (!Symbol)
+			continue; // the function was dropped after a codegen error
+		if (auto Addr = Symbol.getAddress())
+			Site.Count = *(uint64_t *)(intptr_t)*Addr;
+		else
+			consumeError(Addr.takeError());
+	}
+}
+
+void printProfileReport(raw_ostream &OS) {
+	std::vector<const ProfileSite *> Hot;
+	for (const ProfileSite &Site : ProfileSites)
+		if (Site.Count)
+			Hot.push_back(&Site);
+	std::stable_sort(Hot.begin(), Hot.end(),
+		[](const ProfileSite *A, const ProfileSite *B) {
+		return A->Count > B->Count;
+	});
+
+	OS << "===" << std::string(73, '-') << "===\n"
+		<< "                        VSL execution profile\n"
+		<< "===" << std::string(73, '-') << "===\n";
+	OS << "         Count  Function             Site\n";
+	const size_t MaxShown = 20;
+	for (size_t i = 0; i != Hot.size() && i != MaxShown; ++i) {
+		const ProfileSite &Site = *Hot[i];
+		OS << format("  %12llu  %-20s %-5s line %d:%d\n",
+			(unsigned long long)Site.Count, Site.Function.c_str(),
+			getKindName(Site.Kind), Site.Line, Site.Col);
+	}
+	if (Hot.size() > MaxShown)
+		OS << "  ... " << Hot.size() - MaxShown << " more\n";
+	OS << "\n";
+}
+
+bool writeProfile(StringRef Path) {
+	std::error_code EC;
+	raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+	if (EC) {
+		errs() << "Could not open " << Path << ": " << EC.message() << "\n";
+		return false;
+	}
+	for (const ProfileSite &Site : ProfileSites)
+		OS << Site.Function << ' ' << getKindName(Site.Kind) << ' ' << Site.Line
+			<< ' ' << Site.Col << ' ' << Site.Count << '\n';
+	return true;
+}
+
+bool readProfile(StringRef Path) {
+	auto Buffer = MemoryBuffer::getFile(Path);
+	if (!Buffer) {
+		errs() << "Could not open " << Path << ": "
+			<< Buffer.getError().message() << "\n";
+		return false;
+	}
+	SmallVector<StringRef, 8> Lines, Fields;
+	(*Buffer)->getBuffer().split(Lines, '\n', -1, false);
+	for (StringRef Line : Lines) {
+		Fields.clear();
+		Line.trim().split(Fields, ' ', -1, false);
+		int SiteLine, SiteCol;
+		uint64_t Count;
+		if (Fields.size() != 5 || Fields[2].getAsInteger(10, SiteLine) ||
+			Fields[3].getAsInteger(10, SiteCol) ||
+			Fields[4].getAsInteger(10, Count) ||
+			std::find(std::begin(KindNames), std::end(KindNames), Fields[1]) ==
+				std::end(KindNames)) {
+			errs() << Path << ": malformed profile line '" << Line << "'\n";
+			return false;
+		}
+		ProfileCounts[getSiteKey(Fields[0], Fields[1], SiteLine, SiteCol)] = Count;
+	}
+	ProfileUseEnabled = true;
+	return true;
+}
+
+Optional<uint64_t> getProfileCount(ProfileSiteKind Kind, StringRef Function,
+                                   int Line, int Col) {
+	auto It = ProfileCounts.find(
+		getSiteKey(Function, getKindName(Kind), Line, Col));
+	if (It == ProfileCounts.end())
+		return None;
+	return It->second;
+}
+
+void setProfileWeights(Instruction *Br, uint64_t TrueCount,
+                       uint64_t FalseCount) {
+	if (!TrueCount && !FalseCount)
+		return;
+	// Branch weights are 32-bit; keep the ratio.
+	uint64_t Scale = std::max(TrueCount, FalseCount) / UINT32_MAX + 1;
+	MDBuilder MDB(TheContext);
+	Br->setMetadata(LLVMContext::MD_prof,
+		MDB.createBranchWeights(uint32_t(TrueCount / Scale),
+			uint32_t(FalseCount / Scale)));
+}
+
+void emitProfileSummary() {
+	std::vector<uint64_t> Counts;
+	uint64_t Total = 0, MaxCount = 0, MaxFunctionCount = 0;
+	uint32_t NumFunctions = 0;
+	for (auto &Entry : ProfileCounts) {
+		uint64_t Count = Entry.getValue();
+		Counts.push_back(Count);
+		Total += Count;
+		MaxCount = std::max(MaxCount, Count);
+		if (Entry.getKey().split(' ').second.startswith("entry ")) {
+			MaxFunctionCount = std::max(MaxFunctionCount, Count);
+			++NumFunctions;
+		}
+	}
+	std::sort(Counts.begin(), Counts.end(), std::greater<uint64_t>());
+
+	// For every cutoff, the smallest count among the hottest counters that
+	// together make up that fraction of all counts.
+	SummaryEntryVector Detailed;
+	uint64_t Sum = 0;
+	size_t Taken = 0;
+	for (uint32_t Cutoff : ProfileSummaryBuilder::DefaultCutoffs) {
+		double Desired = (double)Total * Cutoff / ProfileSummary::Scale;
+		while (Taken != Counts.size() && Sum < Desired)
+			Sum += Counts[Taken++];
+		Detailed.push_back(
+			ProfileSummaryEntry(Cutoff, Taken ? Counts[Taken - 1] : 0, Taken));
+	}
+	ProfileSummary Summary(ProfileSummary::PSK_Instr, Detailed, Total, MaxCount,
+		MaxCount, MaxFunctionCount, Counts.size(), NumFunctions);
+	TheModule->setProfileSummary(Summary.getMD(TheContext));
+}
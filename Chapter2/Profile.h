@@ -0,0 +1,81 @@
+#pragma once
+#ifndef PROFILE
+#define PROFILE
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Instruction;
+}
+
+//===----------------------------------------------------------------------===//
+// -profile: execution counts of JIT-compiled VSL code
+// -profile-use: feed the counts of an earlier run back into the optimizer
+//===----------------------------------------------------------------------===//
+
+enum ProfileSiteKind {
+	SiteEntry,     // function entries
+	SiteLoop,      // WHILE iterations
+	SiteLoopEntry, // WHILE statements reached
+	SiteLoopRun,   // WHILE statements whose body ran at least once
+	SiteThen,      // IF conditions that held
+	SiteElse,      // IF conditions that did not
+};
+
+/// ProfileSite - One counter inserted by codegen, identified by the function
+/// it is in and the source location of what it counts.
+struct ProfileSite {
+	ProfileSiteKind Kind;
+	std::string Function;
+	int Line, Col;
+	std::string Counter; // name of the i64 global holding the count
+	uint64_t Count;
+};
+
+/// ProfilingEnabled - Set by -profile; no counters are emitted otherwise.
+extern bool ProfilingEnabled;
+/// ProfileSites - Every counter emitted so far, in codegen order.
+extern std::vector<ProfileSite> ProfileSites;
+
+/// emitProfileCounter - Add a site and increment its counter at the current
+/// insertion point.
+void emitProfileCounter(ProfileSiteKind Kind, llvm::StringRef Function,
+                        int Line, int Col);
+
+/// readProfileCounters - Copy the counts out of the JIT; call after main has
+/// returned and before the module is removed.
+void readProfileCounters();
+
+/// printProfileReport - The hottest sites with their source lines.
+void printProfileReport(llvm::raw_ostream &OS);
+
+/// writeProfile - Save the counts, one "function kind line col count" line
+/// per site.  Returns false if the file can't be written.
+bool writeProfile(llvm::StringRef Path);
+
+/// ProfileUseEnabled - Set once readProfile has loaded a profile.
+extern bool ProfileUseEnabled;
+
+/// readProfile - Load counts written by -profile-out.  Sites are matched by
+/// function name and source location, so the program must be unchanged.
+bool readProfile(llvm::StringRef Path);
+
+/// getProfileCount - The count the loaded profile has for a site, if any.
+llvm::Optional<uint64_t> getProfileCount(ProfileSiteKind Kind,
+                                         llvm::StringRef Function, int Line,
+                                         int Col);
+
+/// setProfileWeights - Attach branch weights from profile counts to a
+/// conditional branch.
+void setProfileWeights(llvm::Instruction *Br, uint64_t TrueCount,
+                       uint64_t FalseCount);
+
+/// emitProfileSummary - Describe the loaded profile in TheModule, so that
+/// the inliner can tell hot call sites from cold ones.
+void emitProfileSummary();
+
+#endif // !PROFILE
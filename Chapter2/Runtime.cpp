@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <cstdlib>
+
+//===----------------------------------------------------------------------===//
+// "Library" functions that can be "extern'd" from user code.
+//
+// The JIT resolves them from the compiler process itself; vsl -o links the
+// program with libvsl_rt.a, this file and VectorKernels.cpp, instead.
+//===----------------------------------------------------------------------===//
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#define putc_unlocked _fputc_nolock
+#else
+#define DLLEXPORT
+#endif
+
+/// putchard - putchar that takes a double and returns 0.
+extern "C" DLLEXPORT int putchard(int X) {
+	// With glibc putc_unlocked is an inline append to stdout's buffer that
+	// only calls into the C library when the buffer is full: linked into the
+	// program as bitcode (vsl_runtime.bc), it inlines into PRINT's loops.
+	putc_unlocked((char)X, stdout);
+	return 0;
+}
+//extern "C" DLLEXPORT double putnum(double X) {
+//	int temp = X;
+//	int temp2 = 0;
+//	if (temp == 0)
+//		fputc((char)('0'), stdout);
+//	while (temp>0) {
+//		temp2 = temp2 * 10;
+//		temp2 =temp2+ temp % 10;
+//		if (temp2 == 0)
+//			temp2 = 1;
+//		temp = temp / 10;
+//	}
+//		while (temp2 > 0) {
+//			fputc((char)((temp2 % 10) + '0'), stdout);
+//			temp2 = temp2 / 10;
+//		}
+//	return 0;
+//}
+/// printd - printf that takes a double prints it as "%f\n", returning 0.
+extern "C" DLLEXPORT int printd(int X) {
+	fprintf(stderr, "%d", (int)X);
+	return 0;
+}
+
+/// vsl_bounds_fail - called by array accesses whose index is out of range.
+extern "C" DLLEXPORT int vsl_bounds_fail(int Line) {
+	fflush(stdout);
+	fprintf(stderr, "\narray index out of range at line %d\n", Line);
+	exit(1);
+}
+
+/// vsl_alloc_fail - called when an array sized at run time has a length that
+/// is not positive or cannot be allocated.
+extern "C" DLLEXPORT int vsl_alloc_fail(int Length, int Line) {
+	fflush(stdout);
+	fprintf(stderr, "\ncannot allocate an array of %d elements at line %d\n",
+		Length, Line);
+	exit(1);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef SYMBOLTABLE
+#define SYMBOLTABLE
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// ScopedSymbolTable - Maps variable names to their storage with block
+/// scoping.  Bindings live in one flat vector in declaration order; a hash
+/// index points at the innermost binding of every name, and each binding
+/// remembers the one it shadows.  Lookup is a single hash probe, and popping
+/// a scope just unwinds the vector back to where the scope began.
+template <typename T> class ScopedSymbolTable {
+	struct Entry {
+		std::string Name;
+		T Value;
+		int Shadowed; // index of the hidden outer binding, -1 if none
+	};
+	std::vector<Entry> Entries;
+	std::vector<size_t> ScopeStarts;
+	std::unordered_map<std::string, int> Index;
+
+public:
+	/// pushScope - Start a new scope; bindings made from now on are dropped
+	/// by the matching popScope.
+	void pushScope() { ScopeStarts.push_back(Entries.size()); }
+
+	void popScope() {
+		size_t Start = ScopeStarts.back();
+		ScopeStarts.pop_back();
+		while (Entries.size() > Start) {
+			Entry &E = Entries.back();
+			if (E.Shadowed < 0)
+				Index.erase(E.Name);
+			else
+				Index[E.Name] = E.Shadowed;
+			Entries.pop_back();
+		}
+	}
+
+	/// bind - Declare Name in the current scope, hiding any outer binding.
+	void bind(const std::string &Name, T Value) {
+		int &Slot = Index.emplace(Name, -1).first->second;
+		Entries.push_back(Entry{ Name, Value, Slot });
+		Slot = (int)Entries.size() - 1;
+	}
+
+	/// lookup - The innermost binding of Name, or T() when it is not declared.
+	T lookup(const std::string &Name) const {
+		auto It = Index.find(Name);
+		if (It == Index.end())
+			return T();
+		return Entries[It->second].Value;
+	}
+
+	/// clear - Drop all scopes and bindings, e.g. when starting a new function.
+	void clear() {
+		Entries.clear();
+		ScopeStarts.clear();
+		Index.clear();
+	}
+};
+
+#endif // !SYMBOLTABLE
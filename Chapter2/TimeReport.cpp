@@ -0,0 +1,146 @@
+#include "TimeReport.h"
+#include "llvm/Support/Format.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace llvm;
+
+bool TimePhasesEnabled = false;
+std::chrono::steady_clock::duration LexWallTime{};
+
+static const char *const PhaseNames[NumPhases] = {
+	"parse", "codegen", "optimize", "emit", "link", "jit", "run"
+};
+static TimeRecord PhaseTimes[NumPhases];
+/// PhasePeakRSS - Peak resident set size (KB) sampled when a phase last ended.
+static size_t PhasePeakRSS[NumPhases];
+static std::map<std::string, TimeRecord> FunctionTimes;
+
+/// getPeakRSS - Peak resident set size of the process so far, in KB.
+static size_t getPeakRSS() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS Counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters, sizeof(Counters)))
+		return Counters.PeakWorkingSetSize / 1024;
+	return 0;
+#else
+	struct rusage Usage;
+	if (getrusage(RUSAGE_SELF, &Usage))
+		return 0;
+#ifdef __APPLE__
+	return Usage.ru_maxrss / 1024; // bytes on Darwin
+#else
+	return Usage.ru_maxrss;
+#endif
+#endif
+}
+
+PhaseTimer::PhaseTimer(CompilePhase Phase, StringRef Function)
+	: Phase(Phase), Function(Function) {
+	if (TimePhasesEnabled)
+		Start = TimeRecord::getCurrentTime(true);
+}
+
+PhaseTimer::~PhaseTimer() {
+	if (!TimePhasesEnabled)
+		return;
+	TimeRecord Elapsed = TimeRecord::getCurrentTime(false);
+	Elapsed -= Start;
+	PhaseTimes[Phase] += Elapsed;
+	if (!Function.empty())
+		FunctionTimes[Function] += Elapsed;
+	PhasePeakRSS[Phase] = getPeakRSS();
+}
+
+static double getLexSeconds() {
+	return std::chrono::duration<double>(LexWallTime).count();
+}
+
+/// writeJSONString - Write S as a JSON string literal.
+static void writeJSONString(raw_ostream &OS, StringRef S) {
+	OS << '"';
+	for (char C : S) {
+		if (C == '"' || C == '\\')
+			OS << '\\';
+		OS << C;
+	}
+	OS << '"';
+}
+
+static void printJSONReport(raw_ostream &OS) {
+	OS << "{\n  \"phases\": {\n";
+	OS << "    \"lex\": {\"wall\": " << format("%.6f", getLexSeconds()) << "},\n";
+	for (unsigned P = 0; P != NumPhases; ++P) {
+		const TimeRecord &T = PhaseTimes[P];
+		OS << "    \"" << PhaseNames[P] << "\": {\"wall\": "
+			<< format("%.6f", T.getWallTime()) << ", \"user\": "
+			<< format("%.6f", T.getUserTime()) << ", \"sys\": "
+			<< format("%.6f", T.getSystemTime()) << ", \"peak_rss_kb\": "
+			<< PhasePeakRSS[P] << "}" << (P + 1 != NumPhases ? ",\n" : "\n");
+	}
+	OS << "  },\n  \"functions\": {";
+	const char *Delim = "\n";
+	for (auto &F : FunctionTimes) {
+		OS << Delim << "    ";
+		writeJSONString(OS, F.first);
+		OS << ": {\"wall\": " << format("%.6f", F.second.getWallTime())
+			<< ", \"user\": " << format("%.6f", F.second.getUserTime())
+			<< ", \"sys\": " << format("%.6f", F.second.getSystemTime()) << "}";
+		Delim = ",\n";
+	}
+	OS << "\n  },\n  \"peak_rss_kb\": " << getPeakRSS() << ",\n  \"passes\": {\n";
+	TimerGroup::printAllJSONValues(OS, "");
+	OS << "\n  }\n}\n";
+}
+
+static void printTextReport(raw_ostream &OS) {
+	OS << "===" << std::string(73, '-') << "===\n"
+		<< "                      VSL compilation time report\n"
+		<< "===" << std::string(73, '-') << "===\n";
+	OS << "  Phase                Wall (s)   User (s)    Sys (s)  Peak RSS (KB)\n";
+	for (unsigned P = 0; P != NumPhases; ++P) {
+		const TimeRecord &T = PhaseTimes[P];
+		OS << format("  %-18s %10.4f %10.4f %10.4f %14zu\n", PhaseNames[P],
+			T.getWallTime(), T.getUserTime(), T.getSystemTime(), PhasePeakRSS[P]);
+		if (P == PhaseParse)
+			OS << format("    of which lex     %10.4f\n", getLexSeconds());
+	}
+
+	// Per-function codegen + optimize time, slowest first.
+	std::vector<std::pair<std::string, TimeRecord>> Functions(
+		FunctionTimes.begin(), FunctionTimes.end());
+	std::sort(Functions.begin(), Functions.end(),
+		[](const std::pair<std::string, TimeRecord> &A,
+			const std::pair<std::string, TimeRecord> &B) {
+		return B.second < A.second;
+	});
+	const size_t MaxShown = 20;
+	OS << "\n  Slowest functions (codegen + optimize)\n";
+	OS << "  Function             Wall (s)   User (s)    Sys (s)\n";
+	for (size_t i = 0; i != Functions.size() && i != MaxShown; ++i) {
+		const TimeRecord &T = Functions[i].second;
+		OS << format("  %-18s %10.4f %10.4f %10.4f\n", Functions[i].first.c_str(),
+			T.getWallTime(), T.getUserTime(), T.getSystemTime());
+	}
+	if (Functions.size() > MaxShown)
+		OS << "  ... " << Functions.size() - MaxShown << " more\n";
+	OS << "\n  Peak RSS: " << getPeakRSS() << " KB\n\n";
+
+	// Pass execution timing from the legacy pass manager's TimerGroup.
+	TimerGroup::printAll(OS);
+}
+
+void printTimeReport(raw_ostream &OS, bool JSON) {
+	if (JSON)
+		printJSONReport(OS);
+	else
+		printTextReport(OS);
+}
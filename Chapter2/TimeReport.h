@@ -0,0 +1,45 @@
+#pragma once
+#ifndef TIMEREPORT
+#define TIMEREPORT
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+
+//===----------------------------------------------------------------------===//
+// --time-report: wall/CPU time and peak RSS per compiler phase and function
+//===----------------------------------------------------------------------===//
+
+enum CompilePhase {
+	PhaseParse,    // MainLoop, lexing included
+	PhaseCodegen,  // FunctionAST::codegen
+	PhaseOptimize, // TheFPM->run and OptimizeModule
+	PhaseEmit,     // addPassesToEmitFile and writing output.o, --emit-llvm/bc
+	PhaseLink,     // -o: running the linker
+	PhaseJIT,      // TheJIT->addModule and symbol lookup
+	PhaseRun,      // executing main
+	NumPhases
+};
+
+/// TimePhasesEnabled - Set by --time-report; all timing is skipped otherwise.
+extern bool TimePhasesEnabled;
+/// LexWallTime - Wall time spent inside gettok(), accumulated by getNextToken.
+extern std::chrono::steady_clock::duration LexWallTime;
+
+/// PhaseTimer - Adds the wall/user/system time of its scope to a phase and,
+/// when a function name is given, to that function's own total.
+class PhaseTimer {
+	CompilePhase Phase;
+	std::string Function;
+	llvm::TimeRecord Start;
+
+public:
+	PhaseTimer(CompilePhase Phase, llvm::StringRef Function = llvm::StringRef());
+	~PhaseTimer();
+};
+
+/// printTimeReport - Print the collected timings, human-readable or as JSON.
+/// Pass timings come from the legacy pass manager's TimerGroup.
+void printTimeReport(llvm::raw_ostream &OS, bool JSON);
+
+#endif // !TIMEREPORT
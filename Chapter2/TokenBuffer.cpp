@@ -0,0 +1,75 @@
+#include "TokenBuffer.h"
+#include "TimeReport.h"
+#include <algorithm>
+
+//===----------------------------------------------------------------------===//
+// Pre-lexed input
+//===----------------------------------------------------------------------===//
+
+thread_local TokenBuffer *PreLexed = nullptr;
+thread_local size_t PreLexedPos = 0;
+
+/// TheTokenBuffer - The buffer preLex fills; kept between runs to reuse the
+/// arrays' memory.
+static TokenBuffer TheTokenBuffer;
+
+uint32_t TokenBuffer::intern(const std::string &S) {
+	auto Inserted = StringIDs.try_emplace(S, (uint32_t)Strings.size());
+	// StringMap entries do not move when the table grows.
+	if (Inserted.second)
+		Strings.push_back(Inserted.first->getKey());
+	return Inserted.first->second;
+}
+
+void TokenBuffer::lex(const char *Begin, const char *End,
+                      uint32_t BaseOffset) {
+	Kinds.clear();
+	Offsets.clear();
+	Lengths.clear();
+	Payloads.clear();
+	Strings.clear();
+	StringIDs.clear();
+	this->BaseOffset = BaseOffset;
+
+	// Roughly one token per 4 bytes of source.
+	size_t Expected = (End - Begin) / 4 + 1;
+	Kinds.reserve(Expected);
+	Offsets.reserve(Expected);
+	Lengths.reserve(Expected);
+	Payloads.reserve(Expected);
+
+	setLexerBuffer(Begin, End, BaseOffset);
+	int Tok;
+	do {
+		Tok = gettok();
+		uint32_t Offset, Length;
+		getTokenRange(Offset, Length);
+		uint32_t Payload = 0;
+		if (Tok == VARIABLE)
+			Payload = intern(IdentifierStr);
+		else if (Tok == TEXT)
+			Payload = intern(Text);
+		else if (Tok == INTEGER)
+			Payload = (uint32_t)NumVal;
+		Kinds.push_back((int16_t)Tok);
+		Offsets.push_back(Offset);
+		Lengths.push_back(Length);
+		Payloads.push_back(Payload);
+	} while (Tok != TOKEOF);
+}
+
+void preLex(const char *Begin, const char *End) {
+	auto Start = std::chrono::steady_clock::now();
+	SourceLines.reset(Begin, End);
+	preLex(TheTokenBuffer, Begin, End);
+	if (TimePhasesEnabled)
+		LexWallTime += std::chrono::steady_clock::now() - Start;
+}
+
+void preLex(TokenBuffer &B, const char *Begin, const char *End,
+            uint32_t BaseOffset) {
+	B.lex(Begin, End, BaseOffset);
+	PreLexed = &B;
+	// getNextToken moves to the first token.
+	PreLexedPos = (size_t)-1;
+}
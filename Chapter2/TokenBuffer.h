@@ -0,0 +1,55 @@
+#pragma once
+#ifndef TOKENBUFFER
+#define TOKENBUFFER
+#include "Global.h"
+#include "llvm/ADT/StringMap.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//===----------------------------------------------------------------------===//
+// Pre-lexed input: the whole source lexed up front into parallel arrays
+//===----------------------------------------------------------------------===//
+
+/// TokenBuffer - Every token of a source buffer, one entry per token in each
+/// array.  The last token is always TOKEOF.  Identifiers and texts are
+/// interned: each distinct spelling is stored once, as a key of StringIDs.
+struct TokenBuffer {
+	std::vector<int16_t> Kinds;    // Token, or the character itself
+	std::vector<uint32_t> Offsets; // where the token starts in the source
+	std::vector<uint32_t> Lengths; // length of its spelling
+	std::vector<uint32_t> Payloads; // string ID (VARIABLE, TEXT), value (INTEGER)
+
+	std::vector<llvm::StringRef> Strings; // interned payloads, by ID
+	llvm::StringMap<uint32_t> StringIDs;  // owns the spellings
+
+	/// lex - Lex [Begin, End) into the arrays, replacing their contents.
+	/// Begin is at byte BaseOffset of the input.
+	void lex(const char *Begin, const char *End, uint32_t BaseOffset = 0);
+	size_t size() const { return Kinds.size(); }
+	/// getLoc - The location gettok reports for token Tok, as CurLoc.
+	SourceLocation getLoc(size_t Tok) const { return {BaseOffset + Offsets[Tok]}; }
+
+private:
+	uint32_t intern(const std::string &S);
+	uint32_t BaseOffset = 0;
+};
+
+/// preLex - Lex the whole input [Begin, End) into a TokenBuffer and let
+/// getNextToken read from it.  The buffer must outlive the parse;
+/// setLexerBuffer goes back to lexing on demand.
+void preLex(const char *Begin, const char *End);
+/// preLex - Lex into B instead the part [Begin, End) of the input, which
+/// starts at byte BaseOffset and whose lines SourceLines already has.  Only
+/// the calling thread's getNextToken reads from it, and the time is not added
+/// to the --time-report lexing total.
+void preLex(TokenBuffer &B, const char *Begin, const char *End,
+            uint32_t BaseOffset = 0);
+
+/// PreLexed - The buffer getNextToken reads from, null when lexing on demand.
+/// Like the rest of the lexer state, it is per thread.
+extern thread_local TokenBuffer *PreLexed;
+/// PreLexedPos - Index of CurTok in PreLexed.
+extern thread_local size_t PreLexedPos;
+
+#endif // !TOKENBUFFER
@@ -0,0 +1,327 @@
+#include <climits>
+// GCC and Clang can ask the CPU themselves, which keeps the runtime free of
+// LLVM for the programs vsl -o links with it.
+#if !defined(__GNUC__)
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Host.h"
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VSL_X86 1
+#include <immintrin.h>
+#endif
+
+//===----------------------------------------------------------------------===//
+// Built-in array kernels: vsum, vmin, vmax, vdot, vscale, vprefix.
+//
+// VSL passes an array argument as (pointer to first element, length).  Each
+// kernel has an AVX2 and an SSE2 version on x86 and a scalar fallback; the
+// version is chosen once, from the host CPU features.
+//===----------------------------------------------------------------------===//
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+#if defined(_MSC_VER)
+#define VSL_TARGET_AVX2
+#else
+#define VSL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+SimdLevel detectSimdLevel() {
+#if defined(VSL_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SimdLevel::SSE2;
+#elif defined(VSL_X86)
+	llvm::StringMap<bool> Features;
+	if (llvm::sys::getHostCPUFeatures(Features)) {
+		if (Features.lookup("avx2"))
+			return SimdLevel::AVX2;
+		if (Features.lookup("sse2"))
+			return SimdLevel::SSE2;
+	}
+#if defined(__x86_64__) || defined(_M_X64)
+	return SimdLevel::SSE2; // always present on x86-64
+#endif
+#endif
+	return SimdLevel::Scalar;
+}
+
+SimdLevel getSimdLevel() {
+	static const SimdLevel Level = detectSimdLevel();
+	return Level;
+}
+
+// Scalar versions.  Arithmetic wraps like VSL's i32 arithmetic.
+
+int sumScalar(const int *A, int N) {
+	unsigned S = 0;
+	for (int i = 0; i < N; i++)
+		S += (unsigned)A[i];
+	return (int)S;
+}
+
+int minScalar(const int *A, int N, int M) {
+	for (int i = 0; i < N; i++)
+		if (A[i] < M)
+			M = A[i];
+	return M;
+}
+
+int maxScalar(const int *A, int N, int M) {
+	for (int i = 0; i < N; i++)
+		if (A[i] > M)
+			M = A[i];
+	return M;
+}
+
+int dotScalar(const int *A, const int *B, int N) {
+	unsigned S = 0;
+	for (int i = 0; i < N; i++)
+		S += (unsigned)A[i] * (unsigned)B[i];
+	return (int)S;
+}
+
+void scaleScalar(int *A, int N, int K) {
+	for (int i = 0; i < N; i++)
+		A[i] = (int)((unsigned)A[i] * (unsigned)K);
+}
+
+int prefixScalar(int *A, int N, unsigned Carry) {
+	for (int i = 0; i < N; i++) {
+		Carry += (unsigned)A[i];
+		A[i] = (int)Carry;
+	}
+	return (int)Carry;
+}
+
+#ifdef VSL_X86
+// SSE2 versions.
+
+int hsum128(__m128i V) {
+	V = _mm_add_epi32(V, _mm_shuffle_epi32(V, _MM_SHUFFLE(1, 0, 3, 2)));
+	V = _mm_add_epi32(V, _mm_shuffle_epi32(V, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(V);
+}
+
+/// mullo128 - 32-bit lane multiply; SSE2 only has the 32x32->64 form.
+__m128i mullo128(__m128i A, __m128i B) {
+	__m128i Even = _mm_mul_epu32(A, B);
+	__m128i Odd = _mm_mul_epu32(_mm_srli_epi64(A, 32), _mm_srli_epi64(B, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(Odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/// select128 - Lanes of A where Mask is set, lanes of B elsewhere.
+__m128i select128(__m128i Mask, __m128i A, __m128i B) {
+	return _mm_or_si128(_mm_and_si128(Mask, A), _mm_andnot_si128(Mask, B));
+}
+
+int sumSSE2(const int *A, int N) {
+	__m128i Acc = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 4 <= N; i += 4)
+		Acc = _mm_add_epi32(Acc, _mm_loadu_si128((const __m128i *)(A + i)));
+	return (int)((unsigned)hsum128(Acc) + (unsigned)sumScalar(A + i, N - i));
+}
+
+int minSSE2(const int *A, int N) {
+	__m128i M = _mm_set1_epi32(INT_MAX);
+	int i = 0;
+	for (; i + 4 <= N; i += 4) {
+		__m128i V = _mm_loadu_si128((const __m128i *)(A + i));
+		M = select128(_mm_cmplt_epi32(V, M), V, M);
+	}
+	int Lanes[4];
+	_mm_storeu_si128((__m128i *)Lanes, M);
+	return minScalar(A + i, N - i, minScalar(Lanes, 4, INT_MAX));
+}
+
+int maxSSE2(const int *A, int N) {
+	__m128i M = _mm_set1_epi32(INT_MIN);
+	int i = 0;
+	for (; i + 4 <= N; i += 4) {
+		__m128i V = _mm_loadu_si128((const __m128i *)(A + i));
+		M = select128(_mm_cmpgt_epi32(V, M), V, M);
+	}
+	int Lanes[4];
+	_mm_storeu_si128((__m128i *)Lanes, M);
+	return maxScalar(A + i, N - i, maxScalar(Lanes, 4, INT_MIN));
+}
+
+int dotSSE2(const int *A, const int *B, int N) {
+	__m128i Acc = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 4 <= N; i += 4)
+		Acc = _mm_add_epi32(Acc, mullo128(_mm_loadu_si128((const __m128i *)(A + i)),
+			_mm_loadu_si128((const __m128i *)(B + i))));
+	return (int)((unsigned)hsum128(Acc) + (unsigned)dotScalar(A + i, B + i, N - i));
+}
+
+void scaleSSE2(int *A, int N, int K) {
+	__m128i KV = _mm_set1_epi32(K);
+	int i = 0;
+	for (; i + 4 <= N; i += 4) {
+		__m128i V = _mm_loadu_si128((const __m128i *)(A + i));
+		_mm_storeu_si128((__m128i *)(A + i), mullo128(V, KV));
+	}
+	scaleScalar(A + i, N - i, K);
+}
+
+int prefixSSE2(int *A, int N) {
+	// Running total of everything before the current four lanes.
+	__m128i Carry = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 4 <= N; i += 4) {
+		__m128i V = _mm_loadu_si128((const __m128i *)(A + i));
+		V = _mm_add_epi32(V, _mm_slli_si128(V, 4));
+		V = _mm_add_epi32(V, _mm_slli_si128(V, 8));
+		V = _mm_add_epi32(V, Carry);
+		_mm_storeu_si128((__m128i *)(A + i), V);
+		Carry = _mm_shuffle_epi32(V, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	return prefixScalar(A + i, N - i, (unsigned)_mm_cvtsi128_si32(Carry));
+}
+
+// AVX2 versions.
+
+VSL_TARGET_AVX2 int hsum256(__m256i V) {
+	return hsum128(_mm_add_epi32(_mm256_castsi256_si128(V),
+		_mm256_extracti128_si256(V, 1)));
+}
+
+VSL_TARGET_AVX2 int sumAVX2(const int *A, int N) {
+	__m256i Acc0 = _mm256_setzero_si256(), Acc1 = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 16 <= N; i += 16) {
+		Acc0 = _mm256_add_epi32(Acc0, _mm256_loadu_si256((const __m256i *)(A + i)));
+		Acc1 = _mm256_add_epi32(Acc1, _mm256_loadu_si256((const __m256i *)(A + i + 8)));
+	}
+	return (int)((unsigned)hsum256(_mm256_add_epi32(Acc0, Acc1)) +
+		(unsigned)sumScalar(A + i, N - i));
+}
+
+VSL_TARGET_AVX2 int minAVX2(const int *A, int N) {
+	__m256i M = _mm256_set1_epi32(INT_MAX);
+	int i = 0;
+	for (; i + 8 <= N; i += 8)
+		M = _mm256_min_epi32(M, _mm256_loadu_si256((const __m256i *)(A + i)));
+	int Lanes[8];
+	_mm256_storeu_si256((__m256i *)Lanes, M);
+	return minScalar(A + i, N - i, minScalar(Lanes, 8, INT_MAX));
+}
+
+VSL_TARGET_AVX2 int maxAVX2(const int *A, int N) {
+	__m256i M = _mm256_set1_epi32(INT_MIN);
+	int i = 0;
+	for (; i + 8 <= N; i += 8)
+		M = _mm256_max_epi32(M, _mm256_loadu_si256((const __m256i *)(A + i)));
+	int Lanes[8];
+	_mm256_storeu_si256((__m256i *)Lanes, M);
+	return maxScalar(A + i, N - i, maxScalar(Lanes, 8, INT_MIN));
+}
+
+VSL_TARGET_AVX2 int dotAVX2(const int *A, const int *B, int N) {
+	__m256i Acc = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 8 <= N; i += 8)
+		Acc = _mm256_add_epi32(Acc, _mm256_mullo_epi32(
+			_mm256_loadu_si256((const __m256i *)(A + i)),
+			_mm256_loadu_si256((const __m256i *)(B + i))));
+	return (int)((unsigned)hsum256(Acc) + (unsigned)dotScalar(A + i, B + i, N - i));
+}
+
+VSL_TARGET_AVX2 void scaleAVX2(int *A, int N, int K) {
+	__m256i KV = _mm256_set1_epi32(K);
+	int i = 0;
+	for (; i + 8 <= N; i += 8) {
+		__m256i V = _mm256_loadu_si256((const __m256i *)(A + i));
+		_mm256_storeu_si256((__m256i *)(A + i), _mm256_mullo_epi32(V, KV));
+	}
+	scaleScalar(A + i, N - i, K);
+}
+#endif // VSL_X86
+
+} // end anonymous namespace
+
+/// vsum - Sum of all elements.
+extern "C" DLLEXPORT int vsum(int *A, int N) {
+#ifdef VSL_X86
+	switch (getSimdLevel()) {
+	case SimdLevel::AVX2: return sumAVX2(A, N);
+	case SimdLevel::SSE2: return sumSSE2(A, N);
+	default: break;
+	}
+#endif
+	return sumScalar(A, N);
+}
+
+/// vmin - Smallest element (signed); INT_MAX for an empty array.
+extern "C" DLLEXPORT int vmin(int *A, int N) {
+#ifdef VSL_X86
+	switch (getSimdLevel()) {
+	case SimdLevel::AVX2: return minAVX2(A, N);
+	case SimdLevel::SSE2: return minSSE2(A, N);
+	default: break;
+	}
+#endif
+	return minScalar(A, N, INT_MAX);
+}
+
+/// vmax - Largest element (signed); INT_MIN for an empty array.
+extern "C" DLLEXPORT int vmax(int *A, int N) {
+#ifdef VSL_X86
+	switch (getSimdLevel()) {
+	case SimdLevel::AVX2: return maxAVX2(A, N);
+	case SimdLevel::SSE2: return maxSSE2(A, N);
+	default: break;
+	}
+#endif
+	return maxScalar(A, N, INT_MIN);
+}
+
+/// vdot - Dot product over the common length of A and B.
+extern "C" DLLEXPORT int vdot(int *A, int NA, int *B, int NB) {
+	int N = NA < NB ? NA : NB;
+#ifdef VSL_X86
+	switch (getSimdLevel()) {
+	case SimdLevel::AVX2: return dotAVX2(A, B, N);
+	case SimdLevel::SSE2: return dotSSE2(A, B, N);
+	default: break;
+	}
+#endif
+	return dotScalar(A, B, N);
+}
+
+/// vscale - Multiply every element by K in place, returning 0.
+extern "C" DLLEXPORT int vscale(int *A, int N, int K) {
+#ifdef VSL_X86
+	switch (getSimdLevel()) {
+	case SimdLevel::AVX2: scaleAVX2(A, N, K); return 0;
+	case SimdLevel::SSE2: scaleSSE2(A, N, K); return 0;
+	default: break;
+	}
+#endif
+	scaleScalar(A, N, K);
+	return 0;
+}
+
+/// vprefix - Replace every element by the sum of it and all elements before
+/// it, returning the total.  The SSE2 version is used on AVX2 hosts too, the
+/// scan doesn't gain from wider lanes.
+extern "C" DLLEXPORT int vprefix(int *A, int N) {
+#ifdef VSL_X86
+	if (getSimdLevel() != SimdLevel::Scalar)
+		return prefixSSE2(A, N);
+#endif
+	return prefixScalar(A, N, 0);
+}
@@ -1,5 +1,12 @@
 #pragma once
 #include "Global.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils.h"
+#include "llvm/Transforms/Vectorize.h"
 //#include "llvm/Transforms/InstCombine/InstCombine.h"
 void InitializeModule() {
 	// Open a new module.
@@ -15,17 +22,75 @@ void InitializeModule() {
 //
 //    TheFPM->add(createPromoteMemoryToRegisterPass());
 
+	// -O0: leave the code exactly as generated.
+	if (OptLevel == 0) {
+		TheFPM->doInitialization();
+		return;
+	}
+
+	// Let the cost models (loop vectorizer) see the real target.
+	TheFPM->add(createTargetTransformInfoWrapperPass(
+		TheJIT->getTargetMachine().getTargetIRAnalysis()));
+	// Promote allocas to registers, so loop variables become PHIs.
+	TheFPM->add(createPromoteMemoryToRegisterPass());
 	// Do simple "peephole" optimizations and bit-twiddling optzns.
-	//TheFPM->add(createInstructionCombiningPass());
+	TheFPM->add(createInstructionCombiningPass());
 	// Reassociate expressions.
-	//TheFPM->add(createReassociatePass());
+	TheFPM->add(createReassociatePass());
 	// Eliminate Common SubExpressions.
-	//TheFPM->add(createGVNPass());
+	TheFPM->add(createGVNPass());
 	// Simplify the control flow graph (deleting unreachable blocks, etc).
-	//TheFPM->add(createCFGSimplificationPass());
+	TheFPM->add(createCFGSimplificationPass());
+	if (OptLevel >= 2) {
+		// Canonicalize WHILE loops and turn array loops into SIMD code.
+		TheFPM->add(createLoopRotatePass());
+		TheFPM->add(createIndVarSimplifyPass());
+		TheFPM->add(createLoopVectorizePass());
+		if (OptLevel >= 3)
+			TheFPM->add(createLoopUnrollPass());
+		TheFPM->add(createInstructionCombiningPass());
+		TheFPM->add(createCFGSimplificationPass());
+	}
 
 	TheFPM->doInitialization();
 }
+/// OptimizeModule - Module level optimization at -O2 and up, run once every function has
+/// been generated: inline calls regardless of the order the callee was
+/// defined in, then clean up what inlining exposed.
+void OptimizeModule() {
+	if (OptLevel < 2)
+		return;
+	legacy::PassManager MPM;
+	MPM.add(createFunctionInliningPass(OptLevel, 0, false));
+	MPM.add(createInstructionCombiningPass());
+	MPM.add(createCFGSimplificationPass());
+	MPM.run(*TheModule);
+}
+bool LinkRuntimeBitcode(StringRef Path) {
+	SMDiagnostic Err;
+	std::unique_ptr<Module> Runtime = parseIRFile(Path, Err, TheContext);
+	if (!Runtime) {
+		Err.print("vsl", errs());
+		return false;
+	}
+	// Compiled by clang for the host, like the JIT's target.
+	Runtime->setDataLayout(TheModule->getDataLayout());
+	Runtime->setTargetTriple(TheModule->getTargetTriple());
+	std::vector<std::string> Defined;
+	for (Function &F : *Runtime)
+		if (!F.isDeclaration())
+			Defined.push_back(F.getName().str());
+	if (Linker::linkModules(*TheModule, std::move(Runtime),
+	                        Linker::Flags::LinkOnlyNeeded))
+		return false;
+	// The program's own copies: nothing outside calls them, and the inliner
+	// drops the bodies it has inlined everywhere.
+	for (const std::string &Name : Defined)
+		if (Function *F = TheModule->getFunction(Name))
+			if (!F->isDeclaration())
+				F->setLinkage(GlobalValue::InternalLinkage);
+	return true;
+}
 Function *getFunction(std::string Name) {
 	// First, see if the function has already been added to the current module.
 	if (auto *F = TheModule->getFunction(Name))
@@ -1,5 +1,18 @@
 #pragma once
+#include "CHeader.h"
 #include "DebugInfo.h"
+#include "ParallelParse.h"
+#include "ParseTrace.h"
+#include "Profile.h"
+#include "TimeReport.h"
+#include "TokenBuffer.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include <fstream>
 
 using namespace llvm;
@@ -25,44 +38,125 @@ void MainLoop() {
   }
 }
 //===----------------------------------------------------------------------===//
-// "Library" functions that can be "extern'd" from user code.
+// Built-in functions (the runtime itself is in Runtime.cpp).
 //===----------------------------------------------------------------------===//
-//print
-#ifdef _WIN32
-#define DLLEXPORT __declspec(dllexport)
-#else
-#define DLLEXPORT
-#endif
-
-/// putchard - putchar that takes a double and returns 0.
-extern "C" DLLEXPORT int putchard(int X) {
-	fputc((char)X, stdout);
-return 0;
-}
-//extern "C" DLLEXPORT double putnum(double X) {
-//	int temp = X;
-//	int temp2 = 0;
-//	if (temp == 0)
-//		fputc((char)('0'), stdout);
-//	while (temp>0) {
-//		temp2 = temp2 * 10;
-//		temp2 =temp2+ temp % 10;
-//		if (temp2 == 0)
-//			temp2 = 1;
-//		temp = temp / 10;
-//	}
-//		while (temp2 > 0) {
-//			fputc((char)((temp2 % 10) + '0'), stdout);
-//			temp2 = temp2 / 10;
-//		}
-//	return 0;
-//}
-/// printd - printf that takes a double prints it as "%f\n", returning 0.
-extern "C" DLLEXPORT int printd(int X) {
-	fprintf(stderr, "%d", (int)X);
-	return 0;
+/// addArrayBuiltin - Register the prototype of a built-in array kernel (see
+/// VectorKernels.cpp), so VSL code can call it like putchard/printd.
+static void addArrayBuiltin(const std::string &Name,
+                            std::vector<std::string> ArgNames,
+                            std::vector<bool> ArrayArgs, bool ReadOnly) {
+  auto Proto = llvm::make_unique<PrototypeAST>(Name, std::move(ArgNames));
+  Proto->setArrayArgs(std::move(ArrayArgs));
+  Proto->addFnAttr(Attribute::ArgMemOnly);
+  Proto->addFnAttr(Attribute::NoUnwind);
+  Proto->addArrayAttr(Attribute::NoCapture);
+  if (ReadOnly) {
+    Proto->addFnAttr(Attribute::ReadOnly);
+    Proto->addArrayAttr(Attribute::ReadOnly);
+  }
+  FunctionProtos[Name] = std::move(Proto);
+  getFunction(Name);
 }
 
+//===----------------------------------------------------------------------===//
+// Command line options.
+//===----------------------------------------------------------------------===//
+
+enum TimeReportKind { NoTimeReport, TextTimeReport, JSONTimeReport };
+static cl::opt<TimeReportKind> TimeReport(
+    "time-report", cl::ValueOptional, cl::init(NoTimeReport),
+    cl::desc("Report time and peak memory per compiler phase and function"),
+    cl::values(clEnumValN(TextTimeReport, "", "human-readable (default)"),
+               clEnumValN(TextTimeReport, "text", "human-readable"),
+               clEnumValN(JSONTimeReport, "json", "JSON")));
+
+static cl::opt<bool> Profile(
+    "profile",
+    cl::desc("Count function entries and WHILE iterations, report at exit"));
+static cl::opt<std::string> ProfileOut(
+    "profile-out", cl::value_desc("file"),
+    cl::desc("Also write the -profile counts to <file>"));
+
+static cl::opt<std::string> ProfileUse(
+    "profile-use", cl::value_desc("file"),
+    cl::desc("Optimize with the counts saved by an earlier -profile-out run"));
+
+static cl::opt<bool> PerfMap(
+    "perf-map",
+    cl::desc("Describe JIT-compiled functions to perf: /tmp/perf-<pid>.map, "
+             "plus a jitdump if LLVM was built with LLVM_USE_PERF"));
+
+static cl::opt<bool> Stream(
+    "stream",
+    cl::desc("Compile each FUNC as soon as it is read and run main once it "
+             "and its callees are compiled, before the input ends"));
+
+static cl::opt<std::string> CacheDir(
+    "cache-dir", cl::value_desc("dir"),
+    cl::desc("Compile each FUNC on its own and keep its object file in <dir>; "
+             "later runs only recompile the definitions that changed"));
+
+static cl::opt<unsigned> ParseThreads(
+    "parse-threads", cl::value_desc("n"), cl::init(0),
+    cl::desc("Parse the definitions on <n> threads, 0 for one per core "
+             "(default = 0)"));
+
+static cl::opt<std::string> EmitLLVM(
+    "emit-llvm", cl::value_desc("file"),
+    cl::desc("Write the optimized module as LLVM IR text to <file> "
+             "('-' for standard output)"));
+
+static cl::opt<std::string> EmitBC(
+    "emit-bc", cl::value_desc("file"),
+    cl::desc("Write the optimized module as LLVM bitcode to <file>"));
+
+static cl::list<std::string> EmitFunctions(
+    "emit-function", cl::value_desc("name"), cl::CommaSeparated,
+    cl::desc("With --emit-llvm/--emit-bc, keep only these functions' bodies; "
+             "the others become declarations"));
+
+static cl::opt<std::string> OutputFilename(
+    "o", cl::value_desc("file"),
+    cl::desc("Link the program with the VSL runtime into the executable "
+             "<file> instead of running it"));
+
+static cl::opt<bool> Shared(
+    "shared",
+    cl::desc("With -o, link a shared library exporting the FUNCs, with the "
+             "runtime inside, and write a C header of their prototypes"));
+
+static cl::opt<std::string> HeaderFilename(
+    "header", cl::value_desc("file"),
+    cl::desc("The --shared header (default: the -o file with a .h "
+             "extension)"));
+
+static cl::opt<std::string> Linker(
+    "linker", cl::value_desc("program"), cl::init("c++"),
+    cl::desc("Compiler driver that links -o executables (default = c++)"));
+
+static cl::opt<std::string> RuntimeLibrary(
+    "vsl-runtime", cl::value_desc("file"),
+    cl::desc("Static VSL runtime linked into -o executables (default: "
+             "libvsl_rt.a next to the vsl executable)"));
+
+static cl::opt<std::string> RuntimeBitcode(
+    "runtime-bc", cl::value_desc("file"),
+    cl::desc("At -O2 and up, link the runtime from this bitcode before "
+             "optimizing so PRINT can be inlined; 'none' calls the native "
+             "runtime (default: vsl_runtime.bc next to vsl, if built)"));
+
+static cl::opt<DebugInfoLevel> DebugLevelOpt(
+    "g", cl::Prefix, cl::ZeroOrMore, cl::ValueOptional, cl::init(FullDebugInfo),
+    cl::desc("Debug info level (default = '-g2')"),
+    cl::values(clEnumValN(FullDebugInfo, "", "-g: same as -g2"),
+               clEnumValN(NoDebugInfo, "0", "-g0: none"),
+               clEnumValN(LineTablesOnly, "1", "-g1: line tables only"),
+               clEnumValN(FullDebugInfo, "2", "-g2: also parameters")));
+
+static cl::opt<char> OptLevelOpt(
+    "O", cl::Prefix, cl::ZeroOrMore, cl::init('2'),
+    cl::desc("Optimization level. [-O0, -O1, -O2, or -O3] (default = '-O2')"));
+
 //===----------------------------------------------------------------------===//
 // Main driver code.
 //===----------------------------------------------------------------------===//
@@ -70,45 +164,242 @@ extern "C" DLLEXPORT int printd(int X) {
 // extern std::unique_ptr<DIBuilder> DBuilder;
 extern DebugInfo KSDbgInfo;
 
-int main() {
+/// runMain - Look up main in the JIT, link it and run it.
+static void runMain() {
+  int (*FP)();
+  {
+    PhaseTimer T(PhaseJIT);
+    auto ExprSymbol = TheJIT->findSymbol("main");
+    assert(ExprSymbol && "Function not found");
+    fprintf(stderr, "\n\n");
+    FP = (int (*)())(intptr_t)cantFail(ExprSymbol.getAddress());
+  }
+  int Ret;
+  {
+    PhaseTimer T(PhaseRun);
+    Ret = FP();
+  }
+  fflush(stdout);
+  fprintf(stderr, "\nmain return %d\n", Ret);
+  if (ProfilingEnabled)
+    readProfileCounters();
+}
+
+/// printReports - Print the -profile and --time-report results at the end of
+/// the run.  Returns false if the -profile-out file could not be written.
+static bool printReports() {
+  if (ProfilingEnabled) {
+    printProfileReport(errs());
+    if (!ProfileOut.empty() && !writeProfile(ProfileOut))
+      return false;
+  }
+  if (TimeReport != NoTimeReport)
+    printTimeReport(errs(), TimeReport == JSONTimeReport);
+  return true;
+}
+
+/// ParseInput - Parse all of Input, split at its top-level FUNCs over
+/// -parse-threads threads where that gives the same definitions.
+static void ParseInput(const MemoryBuffer &Input) {
+  PhaseTimer T(PhaseParse);
+  // The trace is written in parse order, so it needs the serial parse.
+  if (ParseThreads != 1 && !ParseTrace::Enabled &&
+      ParseDefinitionsParallel(Input.getBufferStart(), Input.getBufferEnd(),
+                               ParseThreads))
+    return;
+  preLex(Input.getBufferStart(), Input.getBufferEnd());
+  // Prime the first token.
+  getNextToken();
+  MainLoop();
+}
+
+/// writeModule - --emit-llvm/--emit-bc: write TheModule, or with
+/// --emit-function a copy holding only the chosen bodies, to Filename.
+static bool writeModule(StringRef Filename, bool Bitcode) {
+  const Module *M = TheModule.get();
+  std::unique_ptr<Module> Filtered;
+  if (!EmitFunctions.empty()) {
+    for (const std::string &Name : EmitFunctions)
+      if (!TheModule->getFunction(Name))
+        errs() << "warning: --emit-function: no function named '" << Name
+               << "'\n";
+    ValueToValueMapTy VMap;
+    Filtered = CloneModule(*TheModule, VMap, [](const GlobalValue *GV) {
+      // Globals (the PRINT texts) stay whole.
+      return !isa<Function>(GV) || is_contained(EmitFunctions, GV->getName());
+    });
+    M = Filtered.get();
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(Filename, EC, Bitcode ? sys::fs::F_None : sys::fs::F_Text);
+  if (EC) {
+    errs() << "Could not open " << Filename << ": " << EC.message() << "\n";
+    return false;
+  }
+  if (Bitcode)
+    WriteBitcodeToFile(*M, OS);
+  else
+    M->print(OS, nullptr);
+  return true;
+}
+
+/// findNextToExecutable - The file Name in the directory of this executable,
+/// where the build and install put the runtime.
+static std::string findNextToExecutable(const char *Argv0, StringRef Name) {
+  std::string Exe =
+      sys::fs::getMainExecutable(Argv0, (void *)(intptr_t)findNextToExecutable);
+  SmallString<256> Path(sys::path::parent_path(Exe));
+  sys::path::append(Path, Name);
+  return Path.str().str();
+}
+
+/// findRuntimeLibrary - -vsl-runtime, or libvsl_rt.a next to this executable.
+static std::string findRuntimeLibrary(const char *Argv0) {
+  if (!RuntimeLibrary.empty())
+    return RuntimeLibrary;
+  return findNextToExecutable(Argv0, "libvsl_rt.a");
+}
+
+/// linkExecutable - -o: link Object and the static runtime into
+/// OutputFilename, an executable or with --shared a shared library, with the
+/// -linker driver.
+static bool linkExecutable(StringRef Object, const char *Argv0) {
+  PhaseTimer T(PhaseLink);
+  auto Program = sys::findProgramByName(Linker);
+  if (!Program) {
+    errs() << Argv0 << ": cannot find the linker '" << Linker << "'\n";
+    return false;
+  }
+  std::string Runtime = findRuntimeLibrary(Argv0);
+  if (!sys::fs::exists(Runtime)) {
+    errs() << Argv0 << ": cannot find the VSL runtime " << Runtime
+           << " (see -vsl-runtime)\n";
+    return false;
+  }
+  std::vector<StringRef> Args = {*Program, Object, Runtime, "-o",
+                                 OutputFilename};
+  if (Shared)
+    Args.push_back("-shared");
+  std::string ErrMsg;
+  int Status = sys::ExecuteAndWait(*Program, Args, None, {}, 0, 0, &ErrMsg);
+  if (Status != 0) {
+    errs() << Argv0 << ": linking " << OutputFilename << " failed";
+    if (!ErrMsg.empty())
+      errs() << ": " << ErrMsg;
+    errs() << "\n";
+    return false;
+  }
+  return true;
+}
+
+/// StreamLoop - -stream: every definition goes to the JIT in a module of its
+/// own as soon as its callees have prototypes, and main runs as soon as
+/// everything it calls is compiled, however much input follows.  There is no
+/// whole-module optimization and no output.o in this mode.
+static void StreamLoop() {
+  bool MainRun = false;
+  while (CurTok == FUNC) {
+    {
+      PhaseTimer T(PhaseParse);
+      HandleDefinition();
+    }
+    if (StreamReadyDefinitions() && !MainRun) {
+      MainRun = true;
+      runMain();
+    }
+  }
+  if (CurTok != TOKEOF)
+    LogErrorP("Expected 'FUNC' ");
+  reportUnstreamedDefinitions();
+  if (!MainRun)
+    fprintf(stderr, hasMainFunction
+                        ? "main was not run: a function it calls is missing\n"
+                        : "don't have main function!\n");
+}
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "VSL compiler\n");
+  if (OptLevelOpt < '0' || OptLevelOpt > '3') {
+    errs() << argv[0] << ": invalid optimization level.\n";
+    return 1;
+  }
+  OptLevel = OptLevelOpt - '0';
+  KSDbgInfo.Level = DebugLevelOpt;
+  ProfilingEnabled = Profile || !ProfileOut.empty();
+  ObjectCacheDir = CacheDir;
+  if ((Stream || !ObjectCacheDir.empty()) &&
+      (!EmitLLVM.empty() || !EmitBC.empty() || !OutputFilename.empty())) {
+    errs() << argv[0]
+           << ": --emit-llvm/--emit-bc/-o need the whole module, not -stream "
+              "or -cache-dir\n";
+    return 1;
+  }
+  if (Shared && OutputFilename.empty()) {
+    errs() << argv[0] << ": --shared needs -o <library>\n";
+    return 1;
+  }
+  if (ProfilingEnabled && !OutputFilename.empty()) {
+    errs() << argv[0] << ": -profile counts a JIT run; it cannot be used with -o\n";
+    return 1;
+  }
+  if (TimeReport != NoTimeReport) {
+    TimePhasesEnabled = true;
+    TimePassesIsEnabled = true;
+  }
   //ʼ
   InitializeNativeTarget();
   InitializeNativeTargetAsmPrinter();
   InitializeNativeTargetAsmParser();
   // Install standard binary operators.
   // 1 Сȼ
-  BinopPrecedence['='] = 2;
-  BinopPrecedence['<'] = 10;
-  BinopPrecedence['+'] = 20;
-  BinopPrecedence['-'] = 20;
-  BinopPrecedence['*'] = 40; // highest.
-  BinopPrecedence['/'] = 40; // highest.
+  BinopPrecedence.add('=', 2);
+  BinopPrecedence.add('<', 10);
+  BinopPrecedence.add('+', 20);
+  BinopPrecedence.add('-', 20);
+  BinopPrecedence.add('*', 40); // highest.
+  BinopPrecedence.add('/', 40); // highest.
 
-  // Prime the first token.
-  // fprintf(stderr, "ready> ");
-  getNextToken();
+  // -stream lexes the input as it arrives; otherwise all of it is read first.
+  std::unique_ptr<MemoryBuffer> Input;
+  if (!Stream) {
+    PhaseTimer T(PhaseParse);
+    auto InputOrErr = MemoryBuffer::getSTDIN();
+    if (!InputOrErr) {
+      errs() << argv[0] << ": cannot read standard input: "
+             << InputOrErr.getError().message() << "\n";
+      return 1;
+    }
+    Input = std::move(*InputOrErr);
+    // Source locations are 32-bit byte offsets.
+    if (Input->getBufferSize() > UINT32_MAX) {
+      errs() << argv[0] << ": input is larger than 4 GiB\n";
+      return 1;
+    }
+  }
   //ʼTheJITŻ
   TheJIT = llvm::make_unique<KaleidoscopeJIT>();
+  // gdb/lldb pick up the JIT-compiled objects (and their DWARF) through the
+  // GDB JIT interface; perf through the perf map and jitdump.
+  TheJIT->registerJITEventListener(
+      JITEventListener::createGDBRegistrationListener());
+  if (PerfMap) {
+    TheJIT->enablePerfMap();
+    TheJIT->registerJITEventListener(
+        JITEventListener::createPerfJITEventListener());
+  }
 
   InitializeModule();
   // Make the module, which holds all the code.
   // TheModule = llvm::make_unique<Module>("my cool jit", TheContext);
-  // Add the current debug info version into the module.
-  TheModule->addModuleFlag(Module::Warning, "Debug Info Version",
-                           DEBUG_METADATA_VERSION);
-  // Darwin only supports dwarf2.
-  if (Triple(sys::getProcessTriple()).isOSDarwin())
-    TheModule->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 2);
-
-  // Construct the DIBuilder, we do this here because we need the module.
-  DBuilder = llvm::make_unique<DIBuilder>(*TheModule);
-
-  // Create the compile unit for the module.
-  // Currently down as "fib.ks" as a filename since we're redirecting stdin
-  // but we'd like actual source locations.
-  KSDbgInfo.TheCU = DBuilder->createCompileUnit(
-      dwarf::DW_LANG_C, DBuilder->createFile("fib", "."), "VSL Compiler", 0, "",
-      0);
+  KSDbgInfo.initializeModule();
+
+  if (!ProfileUse.empty()) {
+    if (!readProfile(ProfileUse))
+      return 1;
+    emitProfileSummary();
+  }
+
   // Run the main "interpreter loop" now.
   //print
   std::vector<std::string> ArgNames;
@@ -123,13 +414,69 @@ int main() {
 	  30);
   FunctionProtos["printd"] = std::move(Proto);
   TheFunction = getFunction("printd");
-  MainLoop();
+  std::vector<std::string> ArgNames3;
+  ArgNames3.push_back("line");
+  Proto = llvm::make_unique<PrototypeAST>("vsl_bounds_fail", std::move(ArgNames3), false,
+	  30);
+  Proto->addFnAttr(Attribute::NoReturn);
+  Proto->addFnAttr(Attribute::Cold);
+  FunctionProtos["vsl_bounds_fail"] = std::move(Proto);
+  TheFunction = getFunction("vsl_bounds_fail");
+  Proto = llvm::make_unique<PrototypeAST>(
+      "vsl_alloc_fail", std::vector<std::string>{"length", "line"}, false, 30);
+  Proto->addFnAttr(Attribute::NoReturn);
+  Proto->addFnAttr(Attribute::Cold);
+  FunctionProtos["vsl_alloc_fail"] = std::move(Proto);
+  getFunction("vsl_alloc_fail");
+  // SIMD array kernels
+  addArrayBuiltin("vsum", {"a"}, {true}, true);
+  addArrayBuiltin("vmin", {"a"}, {true}, true);
+  addArrayBuiltin("vmax", {"a"}, {true}, true);
+  addArrayBuiltin("vdot", {"a", "b"}, {true, true}, true);
+  addArrayBuiltin("vscale", {"a", "k"}, {true, false}, false);
+  addArrayBuiltin("vprefix", {"a"}, {true}, false);
+  if (Stream) {
+    // Prime the first token.
+    // fprintf(stderr, "ready> ");
+    getNextToken();
+    StreamLoop();
+    return printReports() ? 0 : 1;
+  }
+  if (!ObjectCacheDir.empty()) {
+    ParseInput(*Input);
+    CodegenDefinitionsCached();
+    if (hasMainFunction)
+      runMain();
+    else
+      fprintf(stderr, "don't have main function!\n");
+    return printReports() ? 0 : 1;
+  }
+
+  ParseInput(*Input);
+  CodegenDefinitions();
+  {
+    PhaseTimer T(PhaseOptimize);
+    // Only the -O2 inliner gains anything from the runtime's bodies.  The
+    // bitcode is not built without a matching clang; PRINT then calls the
+    // native runtime.
+    if (OptLevel >= 2 && RuntimeBitcode != "none") {
+      std::string Path = RuntimeBitcode.empty()
+                             ? findNextToExecutable(argv[0], "vsl_runtime.bc")
+                             : RuntimeBitcode.getValue();
+      if ((!RuntimeBitcode.empty() || sys::fs::exists(Path)) &&
+          !LinkRuntimeBitcode(Path))
+        return 1;
+    }
+    OptimizeModule();
+  }
 
   // Finalize the debug info.
-  DBuilder->finalize();
+  KSDbgInfo.finalize();
 
-  // Print out all of the generated code.
-  TheModule->print(errs(), nullptr);
+  // A library's main would clash with the host program's.
+  if (Shared)
+    if (Function *Main = TheModule->getFunction("main"))
+      Main->setLinkage(GlobalValue::InternalLinkage);
 
 
   /*auto H = TheJIT->addModule(std::move(TheModule));
@@ -140,6 +487,7 @@ int main() {
   /***********************************************.oļ*************************************/
   // Initialize the target registry etc.
 
+  auto EmitTimer = llvm::make_unique<PhaseTimer>(PhaseEmit);
   auto TargetTriple = sys::getDefaultTargetTriple();
   TheModule->setTargetTriple(TargetTriple);
 
@@ -158,14 +506,30 @@ int main() {
   auto Features = "";
 
   TargetOptions opt;
-  auto RM = Optional<Reloc::Model>();
+  // -o executables are linked by the system's default, often PIE, rules.
+  auto RM = OutputFilename.empty() ? Optional<Reloc::Model>() : Reloc::PIC_;
   auto TheTargetMachine =
-	  Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM);
+	  Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM, None,
+		  static_cast<CodeGenOpt::Level>(OptLevel));
 
   TheModule->setDataLayout(TheTargetMachine->createDataLayout());
 
-  auto Filename = "output.o";
+  // IR is only formatted when asked for: on large programs it costs more than
+  // running them.
+  if (!EmitLLVM.empty() && !writeModule(EmitLLVM, /*Bitcode=*/false))
+    return 1;
+  if (!EmitBC.empty() && !writeModule(EmitBC, /*Bitcode=*/true))
+    return 1;
+
+  // -o only needs the object until it is linked.
+  SmallString<128> Filename("output.o");
   std::error_code EC;
+  if (!OutputFilename.empty())
+    EC = sys::fs::createTemporaryFile("vsl", "o", Filename);
+  if (EC) {
+	  errs() << "Could not create a temporary file: " << EC.message();
+	  return 1;
+  }
   raw_fd_ostream dest(Filename, EC, sys::fs::F_None);
 
   if (EC) {
@@ -186,25 +550,46 @@ int main() {
 //    }
 
   pass.run(*TheModule);
-  dest.flush();
+  dest.close();
+  EmitTimer.reset();
 
+  if (!OutputFilename.empty()) {
+	  bool Written = true;
+	  if (Shared) {
+		  SmallString<128> Header(HeaderFilename);
+		  if (Header.empty()) {
+			  Header = OutputFilename;
+			  sys::path::replace_extension(Header, "h");
+		  }
+		  Written = writeCHeader(Header);
+	  } else if (!hasMainFunction) {
+		  fprintf(stderr, "don't have main function!\n");
+		  Written = false;
+	  }
+	  bool Linked = Written && linkExecutable(Filename, argv[0]);
+	  sys::fs::remove(Filename);
+	  return printReports() && Linked ? 0 : 1;
+  }
   outs() << "Wrote " << Filename << "\n";
 
 
   /***********************************************************************************/
+  auto JITTimer = llvm::make_unique<PhaseTimer>(PhaseJIT);
+  // perf record -g unwinds JIT-compiled frames through the frame pointer.
+  if (PerfMap)
+	  for (Function &F : *TheModule)
+		  F.addFnAttr("no-frame-pointer-elim", "true");
   auto H = TheJIT->addModule(std::move(TheModule));
-  if (hasMainFunction) {
-	  auto ExprSymbol = TheJIT->findSymbol("main");
-	  assert(ExprSymbol && "Function not found");
-	  fprintf(stderr, "\n\n");
-	  int(*FP)() = (int(*)())(intptr_t)cantFail(ExprSymbol.getAddress());
-	  fprintf(stderr, "\nmain return %d\n", FP());
-  }
-  else {
+  JITTimer.reset();
+  if (hasMainFunction)
+	  runMain();
+  else
 	  fprintf(stderr, "don't have main function!\n");
-  }
   TheJIT->removeModule(H);
 
+  if (!printReports())
+	  return 1;
+
   // Initialize the target registry etc.
   //  InitializeAllTargetInfos();
   //  InitializeAllTargets();
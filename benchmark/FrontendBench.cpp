@@ -0,0 +1,516 @@
+//===----------------------------------------------------------------------===//
+// Front-end micro-benchmarks: lexer and parser throughput on in-memory
+// corpora, independent of stdin, code generation and the JIT.
+//
+//   BM_Lex             tokens/s over a program of N functions
+//   BM_LexCommented    bytes/s over N commented, text-heavy functions, per
+//                      scanning kernel set (scalar, SSE2, AVX2)
+//   BM_ScanKernel      bytes/s of each lexer scanning kernel on its own
+//   BM_PreLex          tokens/s lexing N functions into a TokenBuffer
+//   BM_ParseDefinition nodes/s, allocations and bytes allocated per node over
+//                      N functions
+//   BM_PreLexParseDefinition  the same, pre-lexed first
+//   BM_ParseExpression the same over N expressions
+//   BM_ParseChain      nodes/s parsing one pre-lexed arithmetic chain of N
+//                      operands, flat ('+' '-') or mixed ('+' '-' '*' '/')
+//   BM_ParseDeep       levels/s parsing one expression nested N levels deep:
+//                      parentheses, right-nested sums, prefix operators,
+//                      calls or array indices
+//
+// Before any timing, the expressions of parse_corpus.txt are parsed and their
+// dumps compared with parse_corpus.expected, which the recursive descent
+// parser wrote before ParseExpression became iterative.  A mismatch stops the
+// run.  --parse-corpus-only does only the check; --update-parse-corpus
+// rewrites the expected dumps after an intended change to the trees.
+//===----------------------------------------------------------------------===//
+#include "Global.h"
+#include "LexScan.h"
+#include "TokenBuffer.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+//===----------------------------------------------------------------------===//
+// Allocation counting
+//===----------------------------------------------------------------------===//
+
+static std::atomic<size_t> NumAllocs(0), NumAllocBytes(0);
+
+void *operator new(size_t Size) {
+	++NumAllocs;
+	NumAllocBytes += Size;
+	if (void *P = std::malloc(Size ? Size : 1))
+		return P;
+	llvm::report_bad_alloc_error("out of memory in benchmark");
+}
+void operator delete(void *P) noexcept { std::free(P); }
+void operator delete(void *P, size_t) noexcept { std::free(P); }
+
+//===----------------------------------------------------------------------===//
+// Corpora
+//===----------------------------------------------------------------------===//
+
+/// makeProgram - N functions in the style of the sample programs: locals,
+/// a WHILE with an IF inside, PRINT, and a call to the previous function.
+static std::string makeProgram(int Functions) {
+	std::string S;
+	for (int i = 0; i < Functions; ++i) {
+		std::string N = std::to_string(i);
+		S += "FUNC f" + N + "(a, b){\n"
+			"\tVAR i, s, t\n"
+			"\ts := 0\n"
+			"\ti := 0\n"
+			"\tWHILE i < a\n"
+			"\tDO\n"
+			"\t{\n"
+			"\t\tt := (s * 31 + i) / 7 - b\n"
+			"\t\tIF t < 1000\n"
+			"\t\tTHEN\n"
+			"\t\t\ts := s + t * 2\n"
+			"\t\tELSE\n"
+			"\t\t\ts := s - t\n"
+			"\t\tFI\n"
+			"\t\ti := i + 1\n"
+			"\t}\n"
+			"\tDONE\n"
+			"\tPRINT \"f" + N + " = \", s, \"\\n\"\n";
+		if (i)
+			S += "\tRETURN s + f" + std::to_string(i - 1) + "(b, a)\n}\n";
+		else
+			S += "\tRETURN s\n}\n";
+	}
+	return S;
+}
+
+/// makeCommentedProgram - N functions in the style of generated code: every
+/// statement commented, indented with blanks, and long PRINT texts.
+static std::string makeCommentedProgram(int Functions) {
+	std::string S;
+	for (int i = 0; i < Functions; ++i) {
+		std::string N = std::to_string(i);
+		S += "// f" + N + ": generated function, do not edit.  Computes the "
+			"weighted sum of its arguments and reports it.\n"
+			"FUNC f" + N + "(a, b){\n"
+			"        VAR s                   // running sum\n"
+			"        s := a * 3 + b          // weight the arguments\n"
+			"        PRINT \"f" + N + ": the weighted sum of the two arguments "
+			"is \", s, \"\\n\"\n"
+			"        // nothing to clean up before returning\n"
+			"        RETURN s\n"
+			"}\n\n";
+	}
+	return S;
+}
+
+/// makeExpressions - N expressions separated by ';', cycling through a few
+/// shapes (precedence climbing, parentheses, calls, array indexing).
+static std::string makeExpressions(int Expressions) {
+	static const char *const Shapes[] = {
+		"a + b * c - d / 4",
+		"(a + 1) * (b - 2) / (c + 3)",
+		"x * x + y * y < r * r",
+		"f(a, b + 1, g(c)) * 2",
+		"v[i + 1] - v[i] * 3 + 100",
+		"((((a + b) * c) - d) / e) + (f - (g * (h + i)))",
+	};
+	const int NumShapes = sizeof(Shapes) / sizeof(Shapes[0]);
+	std::string S;
+	for (int i = 0; i < Expressions; ++i) {
+		S += Shapes[i % NumShapes];
+		S += " ;\n";
+	}
+	return S;
+}
+
+/// makeChain - One expression of N operands.  Flat chains use only '+' and
+/// '-', mixed ones alternate them with '*' and '/', so every other operator
+/// binds tighter than the one before it.
+static std::string makeChain(int Operands, bool Mixed) {
+	static const char Flat[] = {'+', '-'}, Tight[] = {'*', '/'};
+	std::string S = "a0";
+	for (int i = 1; i < Operands; ++i) {
+		S += ' ';
+		S += Mixed && i % 2 ? Tight[i / 2 % 2] : Flat[i / 2 % 2];
+		S += i % 3 ? " a" + std::to_string(i % 100) : " " + std::to_string(i % 1000);
+	}
+	S += " ;\n";
+	return S;
+}
+
+/// DeepShape - How makeDeep nests its expression.
+enum DeepShape { DeepParens, DeepRightSum, DeepUnary, DeepCalls, DeepIndex };
+
+/// makeDeep - One expression nested Depth levels deep.
+static std::string makeDeep(int Depth, DeepShape Shape) {
+	static const char *const Open[] = {"(", "a + (", "- ", "f(", "v["};
+	static const char *const Close[] = {")", ")", "", ")", "]"};
+	std::string S;
+	for (int i = 0; i < Depth; ++i)
+		S += Open[Shape];
+	S += "a";
+	for (int i = 0; i < Depth; ++i)
+		S += Close[Shape];
+	S += " ;\n";
+	return S;
+}
+
+/// countNodes - Number of AST nodes, counted as the lines FunctionAST::dump
+/// and ExprAST::dump print (one per node with a source location).
+template <typename AST> static size_t countNodes(AST &Node) {
+	std::string Dump;
+	raw_string_ostream OS(Dump);
+	Node.dump(OS, 0);
+	OS.flush();
+	return std::count(Dump.begin(), Dump.end(), '\n');
+}
+
+//===----------------------------------------------------------------------===//
+// Parse corpus check
+//===----------------------------------------------------------------------===//
+
+/// dumpExpressions - Parse Corpus as a sequence of expressions, each ended by
+/// ';' or by whatever token stops it, and dump, for every one of them, the
+/// tree ("error" if there is none), the token it stopped at and the callees
+/// it recorded.  The stopping token is skipped before the next expression.
+static std::string dumpExpressions(StringRef Corpus) {
+	std::string Dump;
+	raw_string_ostream OS(Dump);
+	setLexerBuffer(Corpus.begin(), Corpus.end());
+	getNextToken();
+	while (CurTok != TOKEOF) {
+		ParsedCallees.clear();
+		if (auto E = ParseExpression())
+			E->dump(OS, 0);
+		else
+			OS << "error\n";
+		OS << "next " << CurTok << "\n";
+		for (const std::string &Callee : ParsedCallees)
+			OS << Callee << ' ';
+		OS << '\n';
+		getNextToken();
+	}
+	OS.flush();
+	return Dump;
+}
+
+/// checkParseCorpus - Compare the dumps of VSL_PARSE_CORPUS ".txt" with
+/// VSL_PARSE_CORPUS ".expected", or write them there if Update is set.
+/// Returns false, having printed the first line that differs, on mismatch.
+static bool checkParseCorpus(bool Update) {
+	std::string Base = VSL_PARSE_CORPUS;
+	auto Corpus = MemoryBuffer::getFile(Base + ".txt");
+	if (!Corpus) {
+		errs() << Base << ".txt: " << Corpus.getError().message() << "\n";
+		return false;
+	}
+	std::string Dump = dumpExpressions((*Corpus)->getBuffer());
+	if (Update) {
+		std::error_code EC;
+		raw_fd_ostream OS(Base + ".expected", EC, sys::fs::F_None);
+		if (EC) {
+			errs() << Base << ".expected: " << EC.message() << "\n";
+			return false;
+		}
+		OS << Dump;
+		return true;
+	}
+	auto Expected = MemoryBuffer::getFile(Base + ".expected");
+	if (!Expected) {
+		errs() << Base << ".expected: " << Expected.getError().message() << "\n";
+		return false;
+	}
+	StringRef Want = (*Expected)->getBuffer(), Got = Dump;
+	if (Want == Got)
+		return true;
+	for (size_t Line = 1;; ++Line) {
+		auto W = Want.split('\n'), G = Got.split('\n');
+		if (W.first != G.first || (W.second.empty() && G.second.empty())) {
+			errs() << Base << ".expected:" << Line << ": parse dump differs\n"
+			       << "  expected: " << W.first << "\n"
+			       << "  got:      " << G.first << "\n";
+			return false;
+		}
+		Want = W.second;
+		Got = G.second;
+	}
+}
+
+//===----------------------------------------------------------------------===//
+// Benchmarks
+//===----------------------------------------------------------------------===//
+
+static void BM_Lex(benchmark::State &State) {
+	std::string Corpus = makeProgram(State.range(0));
+	size_t Tokens = 0;
+	for (auto _ : State) {
+		setLexerBuffer(Corpus.data(), Corpus.data() + Corpus.size());
+		while (gettok() != TOKEOF)
+			++Tokens;
+	}
+	State.SetBytesProcessed(State.iterations() * Corpus.size());
+	State.counters["tokens/s"] =
+		benchmark::Counter(Tokens, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Lex)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_LexCommented(benchmark::State &State) {
+	std::string Corpus = makeCommentedProgram(State.range(0));
+	ScanISA Saved = getScanISA();
+	setScanISA(static_cast<ScanISA>(State.range(1)));
+	State.SetLabel(getScanISAName(getScanISA()));
+	for (auto _ : State) {
+		setLexerBuffer(Corpus.data(), Corpus.data() + Corpus.size());
+		while (gettok() != TOKEOF)
+			;
+	}
+	setScanISA(Saved);
+	State.SetBytesProcessed(State.iterations() * Corpus.size());
+}
+BENCHMARK(BM_LexCommented)
+	->ArgsProduct({{64, 4096}, {ScanScalar, ScanSSE2, ScanAVX2}});
+
+/// BM_ScanKernel - Kernel range(0) over 1 MiB it runs through in one call:
+/// 0 skipWhitespace, 1 findQuoteOrBackslash, 2 countLineBreaks.
+static void BM_ScanKernel(benchmark::State &State) {
+	static const char *const Names[] = {"skipWhitespace", "findQuoteOrBackslash",
+	                                    "countLineBreaks"};
+	std::string Buffer(1 << 20, ' ');
+	for (size_t i = 0; i < Buffer.size(); i += 61)
+		Buffer[i] = '\n';
+	if (State.range(0) != 0)
+		for (size_t i = 0; i < Buffer.size(); i += 7)
+			Buffer[i] = 'x';
+	Buffer.back() = '"';
+	const char *B = Buffer.data(), *E = B + Buffer.size();
+	ScanISA Saved = getScanISA();
+	setScanISA(static_cast<ScanISA>(State.range(1)));
+	State.SetLabel(std::string(Names[State.range(0)]) + "/" +
+	               getScanISAName(getScanISA()));
+	for (auto _ : State) {
+		switch (State.range(0)) {
+		case 0:
+			benchmark::DoNotOptimize(skipWhitespace(B, E));
+			break;
+		case 1:
+			benchmark::DoNotOptimize(findQuoteOrBackslash(B, E));
+			break;
+		case 2:
+			benchmark::DoNotOptimize(countLineBreaks(B, E));
+			break;
+		}
+	}
+	setScanISA(Saved);
+	State.SetBytesProcessed(State.iterations() * Buffer.size());
+}
+BENCHMARK(BM_ScanKernel)
+	->ArgsProduct({{0, 1, 2}, {ScanScalar, ScanSSE2, ScanAVX2}});
+
+static void BM_PreLex(benchmark::State &State) {
+	std::string Corpus = makeProgram(State.range(0));
+	size_t Tokens = 0;
+	for (auto _ : State) {
+		preLex(Corpus.data(), Corpus.data() + Corpus.size());
+		Tokens += PreLexed->size();
+	}
+	State.SetBytesProcessed(State.iterations() * Corpus.size());
+	State.counters["tokens/s"] =
+		benchmark::Counter(Tokens, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PreLex)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_ParseDefinition(benchmark::State &State) {
+	std::string Corpus = makeProgram(State.range(0));
+	std::vector<std::unique_ptr<FunctionAST>> Defs;
+	size_t Nodes = 0, Allocs = 0, Bytes = 0;
+	for (auto _ : State) {
+		setLexerBuffer(Corpus.data(), Corpus.data() + Corpus.size());
+		size_t Before = NumAllocs, BytesBefore = NumAllocBytes;
+		getNextToken();
+		while (CurTok == FUNC) {
+			auto F = ParseDefinition();
+			if (!F) {
+				State.SkipWithError("parse error");
+				return;
+			}
+			Defs.push_back(std::move(F));
+		}
+		Allocs += NumAllocs - Before;
+		Bytes += NumAllocBytes - BytesBefore;
+
+		// Count and free the trees outside the measured region.
+		State.PauseTiming();
+		for (auto &F : Defs)
+			Nodes += countNodes(*F);
+		Defs.clear();
+		State.ResumeTiming();
+	}
+	State.SetBytesProcessed(State.iterations() * Corpus.size());
+	State.counters["nodes/s"] =
+		benchmark::Counter(Nodes, benchmark::Counter::kIsRate);
+	State.counters["allocs/node"] = Nodes ? double(Allocs) / Nodes : 0;
+	State.counters["bytes/node"] = Nodes ? double(Bytes) / Nodes : 0;
+}
+BENCHMARK(BM_ParseDefinition)->RangeMultiplier(8)->Range(8, 4096);
+
+/// BM_PreLexParseDefinition - BM_ParseDefinition with the whole corpus lexed
+/// into a TokenBuffer first, as the driver does outside -stream.
+static void BM_PreLexParseDefinition(benchmark::State &State) {
+	std::string Corpus = makeProgram(State.range(0));
+	std::vector<std::unique_ptr<FunctionAST>> Defs;
+	size_t Nodes = 0;
+	for (auto _ : State) {
+		preLex(Corpus.data(), Corpus.data() + Corpus.size());
+		getNextToken();
+		while (CurTok == FUNC) {
+			auto F = ParseDefinition();
+			if (!F) {
+				State.SkipWithError("parse error");
+				return;
+			}
+			Defs.push_back(std::move(F));
+		}
+
+		State.PauseTiming();
+		for (auto &F : Defs)
+			Nodes += countNodes(*F);
+		Defs.clear();
+		State.ResumeTiming();
+	}
+	State.SetBytesProcessed(State.iterations() * Corpus.size());
+	State.counters["nodes/s"] =
+		benchmark::Counter(Nodes, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PreLexParseDefinition)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_ParseExpression(benchmark::State &State) {
+	std::string Corpus = makeExpressions(State.range(0));
+	std::vector<std::unique_ptr<ExprAST>> Exprs;
+	size_t Nodes = 0, Allocs = 0, Bytes = 0;
+	for (auto _ : State) {
+		setLexerBuffer(Corpus.data(), Corpus.data() + Corpus.size());
+		size_t Before = NumAllocs, BytesBefore = NumAllocBytes;
+		getNextToken();
+		while (CurTok != TOKEOF) {
+			auto E = ParseExpression();
+			if (!E || CurTok != ';') {
+				State.SkipWithError("parse error");
+				return;
+			}
+			getNextToken(); // eat ';'
+			Exprs.push_back(std::move(E));
+		}
+		Allocs += NumAllocs - Before;
+		Bytes += NumAllocBytes - BytesBefore;
+
+		State.PauseTiming();
+		for (auto &E : Exprs)
+			Nodes += countNodes(*E);
+		Exprs.clear();
+		State.ResumeTiming();
+	}
+	State.SetBytesProcessed(State.iterations() * Corpus.size());
+	State.counters["nodes/s"] =
+		benchmark::Counter(Nodes, benchmark::Counter::kIsRate);
+	State.counters["allocs/node"] = Nodes ? double(Allocs) / Nodes : 0;
+	State.counters["bytes/node"] = Nodes ? double(Bytes) / Nodes : 0;
+}
+BENCHMARK(BM_ParseExpression)->RangeMultiplier(8)->Range(64, 64 << 10);
+
+/// BM_ParseChain - ParseExpression alone on a long binary operator chain; the
+/// lexing is done up front, outside the timing.
+static void BM_ParseChain(benchmark::State &State) {
+	int Operands = State.range(0);
+	std::string Corpus = makeChain(Operands, State.range(1));
+	TokenBuffer Tokens;
+	for (auto _ : State) {
+		State.PauseTiming();
+		preLex(Tokens, Corpus.data(), Corpus.data() + Corpus.size());
+		getNextToken();
+		State.ResumeTiming();
+
+		auto E = ParseExpression();
+		if (!E || CurTok != ';') {
+			State.SkipWithError("parse error");
+			return;
+		}
+
+		State.PauseTiming();
+		E.reset();
+		State.ResumeTiming();
+	}
+	PreLexed = nullptr;
+	State.SetItemsProcessed(State.iterations() * Operands);
+	State.counters["nodes/s"] = benchmark::Counter(
+		double(State.iterations()) * (2 * Operands - 1),
+		benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ParseChain)->ArgsProduct({{1 << 10, 1 << 16, 1 << 20}, {0, 1}});
+
+/// BM_ParseDeep - Stress test for the explicit-stack expression parser: the
+/// nesting is far beyond what one native call per level would survive.
+static void BM_ParseDeep(benchmark::State &State) {
+	int Depth = State.range(0);
+	std::string Corpus = makeDeep(Depth, DeepShape(State.range(1)));
+	TokenBuffer Tokens;
+	for (auto _ : State) {
+		State.PauseTiming();
+		preLex(Tokens, Corpus.data(), Corpus.data() + Corpus.size());
+		getNextToken();
+		ParsedCallees.clear();
+		State.ResumeTiming();
+
+		auto E = ParseExpression();
+		if (!E || CurTok != ';') {
+			State.SkipWithError("parse error");
+			return;
+		}
+
+		State.PauseTiming();
+		E.reset();
+		State.ResumeTiming();
+	}
+	PreLexed = nullptr;
+	State.SetItemsProcessed(State.iterations() * Depth);
+}
+BENCHMARK(BM_ParseDeep)
+	->ArgsProduct({{1 << 10, 1 << 20},
+	               {DeepParens, DeepRightSum, DeepUnary, DeepCalls, DeepIndex}})
+	->Unit(benchmark::kMillisecond);
+
+int main(int argc, char **argv) {
+	// The operator table the driver installs in toy.cpp.
+	BinopPrecedence.add('=', 2);
+	BinopPrecedence.add('<', 10);
+	BinopPrecedence.add('+', 20);
+	BinopPrecedence.add('-', 20);
+	BinopPrecedence.add('*', 40);
+	BinopPrecedence.add('/', 40);
+
+	bool CheckOnly = false, Update = false;
+	int Kept = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "--parse-corpus-only"))
+			CheckOnly = true;
+		else if (!strcmp(argv[i], "--update-parse-corpus"))
+			Update = true;
+		else
+			argv[Kept++] = argv[i];
+	}
+	argc = Kept;
+	if (!checkParseCorpus(Update))
+		return 1;
+	if (CheckOnly || Update)
+		return 0;
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Compare running a program under the JIT with running a vsl -o executable.
+
+For each program: the driver compiles and runs it under the JIT, and,
+separately, links it into a standalone executable with -o, which is then run
+on its own.  Reported are the median wall time and peak RSS of the JIT run,
+of the -o compile, and of the executable, plus how much of the JIT run was
+spent before main started (everything but the "run" phase).
+
+usage: aot_startup.py --vsl PATH [--opt 2] [--repeat 5] [--only NAME,...]
+"""
+import argparse
+import os
+import shutil
+import statistics
+import tempfile
+
+import run as suite
+
+SMALL = ["recursion", "print_heavy", "tight_loops", "array_sum",
+         "builtin_kernels"]
+
+
+def jit_run(args, src, work):
+    with open(src, "rb") as stdin:
+        status, wall, rss, stderr = suite.run(
+            [args.vsl, "-O%d" % args.opt, "--time-report=json"], work, stdin,
+            args.timeout)
+    if status != 0:
+        raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+    report, ret = suite.parse_report(stderr)
+    return {"wall": wall, "startup": wall - report["phases"]["run"]["wall"],
+            "rss_kb": rss}, ret
+
+
+def aot_run(args, src, work, exe):
+    with open(src, "rb") as stdin:
+        status, compile_wall, _, stderr = suite.run(
+            [args.vsl, "-O%d" % args.opt, "-o", exe], work, stdin, args.timeout)
+    if status != 0:
+        raise RuntimeError("vsl -o exited with %d\n%s" % (status, stderr[-2000:]))
+    status, wall, rss, stderr = suite.run([exe], work, timeout=args.timeout)
+    return {"compile": compile_wall, "wall": wall, "rss_kb": rss}, status
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--opt", type=int, default=2, help="optimization level")
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--only", help="comma separated benchmark names")
+    parser.add_argument("--timeout", type=float, default=600)
+    args = parser.parse_args()
+    args.vsl = os.path.abspath(args.vsl)
+    names = args.only.split(",") if args.only else SMALL
+    programs = dict(suite.PROGRAMS)
+
+    work = tempfile.mkdtemp(prefix="vsl-aot-")
+    try:
+        print("%-16s %10s %10s %10s %10s %10s %10s %10s"
+              % ("benchmark", "JIT (s)", "startup", "RSS (KB)",
+                 "-o (s)", "exe (s)", "RSS (KB)", "speedup"))
+        for name in names:
+            src = suite.materialize(name, programs[name], work)
+            exe = os.path.join(work, name)
+            jit, obj = [], []
+            for _ in range(args.repeat):
+                sample, jit_ret = jit_run(args, src, work)
+                jit.append(sample)
+                sample, status = aot_run(args, src, work, exe)
+                obj.append(sample)
+                if jit_ret is not None and status != jit_ret & 0xff:
+                    raise RuntimeError("%s: executable returned %d, JIT %d"
+                                       % (name, status, jit_ret))
+            jit, obj = suite.median_of(jit), suite.median_of(obj)
+            print("%-16s %10.4f %10.4f %10d %10.4f %10.4f %10d %9.1fx"
+                  % (name, jit["wall"], jit["startup"], jit["rss_kb"],
+                     obj["compile"], obj["wall"], obj["rss_kb"],
+                     jit["wall"] / obj["wall"]))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
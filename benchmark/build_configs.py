@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Build vsl in several configurations and measure each one's front end and
+JIT startup.
+
+  release   -DCMAKE_BUILD_TYPE=Release
+  thinlto   Release + -DVSL_LTO=Thin
+  pgo       two-stage: an instrumented vsl (-DVSL_PGO=Generate) compiles the
+            benchmark corpus, llvm-profdata merges the profiles, and vsl is
+            rebuilt with -DVSL_PGO=Use (plus ThinLTO with --pgo-lto)
+
+The front end is timed as parse + codegen wall time (--time-report=json at
+-O0) on the large generated programs; JIT startup is the wall time of the
+whole process and of its jit phase on a one-line program.
+
+usage: build_configs.py [--configs release,thinlto,pgo] [--build-root DIR]
+                        [--repeat 5] [--pgo-lto] [--output results.json]
+                        [-- extra cmake arguments]
+
+ThinLTO and the Clang profile format need CC=clang CXX=clang++; with GCC
+only release and pgo are available.
+"""
+import argparse
+import glob
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+import run as suite
+
+ROOT = os.path.abspath(os.path.join(suite.HERE, ".."))
+FRONT_END_PROGRAMS = ["huge_function", "many_functions", "scopes"]
+STARTUP_PROGRAM = "FUNC main(){\nRETURN 0\n}\n"
+
+
+def is_clang():
+    cxx = os.environ.get("CXX", "c++")
+    out = subprocess.run([cxx, "--version"], capture_output=True, text=True)
+    return "clang" in out.stdout.lower()
+
+
+def build(build_dir, cmake_args, extra):
+    subprocess.check_call(["cmake", "-S", ROOT, "-B", build_dir,
+                           "-DCMAKE_BUILD_TYPE=Release"] + cmake_args + extra)
+    subprocess.check_call(["cmake", "--build", build_dir, "--target", "vsl",
+                           "-j%d" % os.cpu_count()])
+    return os.path.join(build_dir, "vsl")
+
+
+def train(vsl, work):
+    """Run the benchmark corpus through an instrumented vsl."""
+    for name, spec in suite.PROGRAMS:
+        src = suite.materialize(name, spec, work)
+        for level in (0, 2):
+            with open(src, "rb") as stdin:
+                suite.run([vsl, "-O%d" % level], work, stdin, timeout=600)
+
+
+def merge_profiles(profile_dir, out):
+    """Merge the raw profiles; GCC's .gcda files are used in place."""
+    raws = glob.glob(os.path.join(profile_dir, "*.profraw"))
+    if not raws:
+        return profile_dir
+    profdata = shutil.which("llvm-profdata") or "llvm-profdata"
+    subprocess.check_call([profdata, "merge", "-o", out] + raws)
+    return out
+
+
+def measure(vsl, work, repeat):
+    """Median front-end and JIT startup times of one vsl binary."""
+    result = {}
+    for name, spec in suite.PROGRAMS:
+        if name not in FRONT_END_PROGRAMS:
+            continue
+        src = suite.materialize(name, spec, work)
+        samples = []
+        for _ in range(repeat):
+            with open(src, "rb") as stdin:
+                status, _, _, stderr = suite.run(
+                    [vsl, "-O0", "--time-report=json"], work, stdin, 600)
+            if status != 0:
+                raise RuntimeError("%s failed on %s" % (vsl, name))
+            phases = suite.parse_report(stderr)[0]["phases"]
+            samples.append(phases["parse"]["wall"] + phases["codegen"]["wall"])
+        result["frontend_s/" + name] = statistics.median(samples)
+
+    src = os.path.join(work, "startup.vsl")
+    with open(src, "w") as f:
+        f.write(STARTUP_PROGRAM)
+    total, jit = [], []
+    for _ in range(repeat):
+        with open(src, "rb") as stdin:
+            status, wall, _, stderr = suite.run(
+                [vsl, "--time-report=json"], work, stdin, 600)
+        if status != 0:
+            raise RuntimeError("%s failed on the startup program" % vsl)
+        total.append(wall)
+        jit.append(suite.parse_report(stderr)[0]["phases"]["jit"]["wall"])
+    result["startup_s/process"] = statistics.median(total)
+    result["startup_s/jit"] = statistics.median(jit)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--configs", default="release,thinlto,pgo")
+    parser.add_argument("--build-root", default=os.path.join(ROOT, "build-configs"))
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--pgo-lto", action="store_true",
+                        help="also use ThinLTO in the PGO optimized stage")
+    parser.add_argument("--output", help="write the measurements here")
+    parser.add_argument("cmake_args", nargs="*",
+                        help="extra arguments for every cmake configure")
+    args = parser.parse_args()
+    configs = args.configs.split(",")
+    clang = is_clang()
+    if not clang and ("thinlto" in configs or args.pgo_lto):
+        sys.exit("ThinLTO needs CC=clang CXX=clang++")
+
+    results = {}
+    work = tempfile.mkdtemp(prefix="vsl-configs-")
+    try:
+        for config in configs:
+            build_dir = os.path.join(args.build_root, config)
+            if config == "release":
+                vsl = build(build_dir, [], args.cmake_args)
+            elif config == "thinlto":
+                vsl = build(build_dir, ["-DVSL_LTO=Thin"], args.cmake_args)
+            elif config == "pgo":
+                profile_dir = os.path.join(build_dir + "-gen", "profiles")
+                shutil.rmtree(profile_dir, ignore_errors=True)
+                gen = build(build_dir + "-gen", ["-DVSL_PGO=Generate",
+                            "-DVSL_PGO_DIR=" + profile_dir], args.cmake_args)
+                train(gen, work)
+                profile = merge_profiles(
+                    profile_dir, os.path.join(args.build_root, "vsl.profdata"))
+                use = ["-DVSL_PGO=Use", "-DVSL_PGO_PROFILE=" + profile]
+                if args.pgo_lto:
+                    use.append("-DVSL_LTO=Thin")
+                vsl = build(build_dir, use, args.cmake_args)
+            else:
+                sys.exit("unknown configuration %s" % config)
+            results[config] = measure(vsl, work, args.repeat)
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+    metrics = sorted({m for r in results.values() for m in r})
+    print("%-28s" % "metric" + "".join("%14s" % c for c in configs))
+    for metric in metrics:
+        print("%-28s" % metric + "".join(
+            "%14.4f" % results[c][metric] for c in configs))
+    if args.output:
+        with open(args.output, "w") as out:
+            json.dump(results, out, indent=2, sort_keys=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Compare compile time and memory at -g0, -g1 and -g2.
+
+Each program is compiled (and run) by the driver with --time-report=json at
+every debug info level.  Reported are the median codegen, optimize and emit
+wall times, their sum, and the peak RSS of the process, each with its change
+against -g0.
+
+usage: debuginfo_compare.py --vsl PATH [--opt 2] [--repeat 5] [--only NAME,...]
+"""
+import argparse
+import shutil
+import statistics
+import tempfile
+
+import run as suite
+
+LARGE = ["huge_function", "many_functions", "scopes"]
+LEVELS = (0, 1, 2)
+PHASES = ("codegen", "optimize", "emit")
+
+
+def measure(args, src, work, level):
+    samples = []
+    for _ in range(args.repeat):
+        with open(src, "rb") as stdin:
+            status, _, rss, stderr = suite.run(
+                [args.vsl, "-O%d" % args.opt, "-g%d" % level,
+                 "--time-report=json"], work, stdin, args.timeout)
+        if status != 0:
+            raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+        phases = suite.parse_report(stderr)[0]["phases"]
+        sample = {p: phases[p]["wall"] for p in PHASES}
+        sample["total"] = sum(sample.values())
+        sample["rss_kb"] = rss
+        samples.append(sample)
+    return suite.median_of(samples)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--opt", type=int, default=2, help="optimization level")
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--only", help="comma separated benchmark names")
+    parser.add_argument("--timeout", type=float, default=600)
+    args = parser.parse_args()
+    names = args.only.split(",") if args.only else LARGE
+    programs = dict(suite.PROGRAMS)
+
+    work = tempfile.mkdtemp(prefix="vsl-debuginfo-")
+    try:
+        print("%-16s %-9s" % ("benchmark", "metric")
+              + "".join("%12s" % ("-g%d" % l) for l in LEVELS)
+              + "".join("%10s" % ("-g%d" % l) for l in LEVELS[1:]))
+        for name in names:
+            src = suite.materialize(name, programs[name], work)
+            results = [measure(args, src, work, level) for level in LEVELS]
+            for metric in PHASES + ("total", "rss_kb"):
+                base = results[0][metric]
+                line = "%-16s %-9s" % (name, metric)
+                line += "".join("%12.4f" % r[metric] for r in results)
+                line += "".join("%+9.1f%%" % ((r[metric] / base - 1) * 100)
+                                if base else "%10s" % "-"
+                                for r in results[1:])
+                print(line)
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
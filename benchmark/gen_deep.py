@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+"""Generate a VSL program whose main() holds two expressions nested DEPTH
+levels deep: one flat chain of DEPTH operators, and DEPTH nested parentheses.
+Both make trees as deep as the expression is long, to stress the parser and
+code generation on machine-generated input.
+
+usage: gen_deep.py [DEPTH] > deep.vsl
+"""
+import sys
+
+OPS = ["+", "-", "*"]
+
+
+def main():
+    depth = int(sys.argv[1]) if len(sys.argv) > 1 else 1000000
+    chain = ["a"]
+    for i in range(1, depth):
+        chain.append(OPS[i % 3])
+        chain.append("b" if i % 2 else str(i % 1000))
+    nested = "(" * depth + "a" + "".join(
+        " %s %d)" % (OPS[i % 2], i % 1000) for i in range(depth))
+    out = ["FUNC main(){", "VAR a, b, s", "a := 3", "b := 5"]
+    out.append("s := " + " ".join(chain))
+    out.append("s := s + " + nested)
+    out.append("RETURN s")
+    out.append("}")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+"""Generate a VSL program made of many small functions, each calling the
+previous one, to measure per-function compile cost and inlining.
+
+usage: gen_functions.py [COUNT] > functions.vsl
+"""
+import sys
+
+
+def main():
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+    out = ["FUNC f0(x){", "RETURN x + 1", "}"]
+    for i in range(1, count):
+        out.append("FUNC f%d(x){" % i)
+        out.append("VAR y")
+        out.append("y := x * %d + %d" % (i % 7 + 1, i))
+        out.append("IF y < %d" % (i * 100))
+        out.append("THEN")
+        out.append("RETURN f%d(y)" % (i - 1))
+        out.append("ELSE")
+        out.append("RETURN f%d(y - x)" % (i - 1))
+        out.append("FI")
+        out.append("}")
+    out.append("FUNC main(){")
+    out.append("VAR r, s")
+    out.append("s := 0")
+    out.append("r := 0")
+    out.append("WHILE r < 1000")
+    out.append("DO")
+    out.append("{")
+    out.append("s := s + f%d(r)" % (count - 1))
+    out.append("r := r + 1")
+    out.append("}")
+    out.append("DONE")
+    out.append("RETURN s")
+    out.append("}")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
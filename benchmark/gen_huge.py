@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""Generate a VSL program whose main() is one huge straight-line function of
+assignments and IFs over a few variables, to measure how codegen and the
+optimizer scale with function size.  The output is fixed for a given size.
+
+usage: gen_huge.py [STATEMENTS] > huge.vsl
+"""
+import random
+import sys
+
+VARS = ["a%d" % i for i in range(16)]
+
+
+def expr(rng):
+    x, y, z = rng.choice(VARS), rng.choice(VARS), rng.choice(VARS)
+    form = rng.randrange(4)
+    if form == 0:
+        return "%s + %s * %d" % (x, y, rng.randrange(1, 9))
+    if form == 1:
+        return "(%s - %s) / %d" % (x, y, rng.randrange(2, 9))
+    if form == 2:
+        return "%s * %s + %s" % (x, y, z)
+    return "%s + %d" % (x, rng.randrange(100))
+
+
+def main():
+    statements = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+    rng = random.Random(statements)
+    out = ["FUNC main(){"]
+    out.append("VAR " + ", ".join(VARS))
+    for i, v in enumerate(VARS):
+        out.append("%s := %d" % (v, i))
+    for _ in range(statements):
+        if rng.randrange(5) == 0:
+            out.append("IF %s < %s" % (rng.choice(VARS), rng.choice(VARS)))
+            out.append("THEN")
+            out.append("%s := %s" % (rng.choice(VARS), expr(rng)))
+            out.append("ELSE")
+            out.append("%s := %s" % (rng.choice(VARS), expr(rng)))
+            out.append("FI")
+        else:
+            out.append("%s := %s" % (rng.choice(VARS), expr(rng)))
+    out.append("RETURN " + " + ".join(VARS))
+    out.append("}")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
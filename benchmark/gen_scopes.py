@@ -0,0 +1,32 @@
+#!/usr/bin/env python3
+"""Generate a VSL program whose main() has many locals and deeply nested
+blocks that shadow them, to measure symbol table cost during codegen.
+
+usage: gen_scopes.py [LOCALS] [DEPTH] > scopes.vsl
+"""
+import sys
+
+
+def main():
+    locals_ = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+    depth = int(sys.argv[2]) if len(sys.argv) > 2 else 500
+    out = ["FUNC main(){"]
+    out.append("VAR " + ", ".join("v%d" % i for i in range(locals_)))
+    for i in range(locals_):
+        out.append("v%d := %d" % (i, i))
+    # Every nesting level shadows a few names and reads outer ones.
+    for d in range(depth):
+        out.append("{")
+        out.append("VAR v%d, v%d, t%d" % (d % locals_, (d * 7) % locals_, d))
+        out.append("t%d := v%d + v%d" % (d, (d * 3 + 1) % locals_, (d * 5 + 2) % locals_))
+        out.append("v%d := t%d" % (d % locals_, d))
+    for d in reversed(range(depth)):
+        out.append("v0 := v0 + t%d" % d)
+        out.append("}")
+    out.append("RETURN v0")
+    out.append("}")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Measure edit-run cycles with -cache-dir.
+
+A program of COUNT functions (gen_functions.py) is run four times against the
+same object cache: cold (empty cache), warm (unchanged source), after editing
+the body of one function, and after editing one function's prototype (its
+callers must be recompiled too).  For each run the wall time and the
+driver's "object cache: N reused, M compiled" line are reported, next to a
+run without -cache-dir.
+
+usage: incremental.py --vsl PATH [--count 2000] [--opt 2] [--repeat 3]
+"""
+import argparse
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+import run as suite
+
+CACHE_LINE = re.compile(r"object cache: (\d+) reused, (\d+) compiled")
+
+
+def generate(count):
+    out = subprocess.check_output(
+        [sys.executable, os.path.join(suite.HERE, "gen_functions.py"), str(count)],
+        text=True)
+    return out
+
+
+def edit_body(src, count):
+    """Change a constant in the middle function."""
+    i = count // 2
+    old = "y := x * %d + %d" % (i % 7 + 1, i)
+    assert old in src
+    return src.replace(old, "y := x * %d + %d" % (i % 7 + 1, i + 1))
+
+
+def edit_prototype(src, count):
+    """Give the middle function an unused second parameter."""
+    i = count // 2
+    src = src.replace("FUNC f%d(x){" % i, "FUNC f%d(x, unused){" % i)
+    return src.replace("f%d(y)" % i, "f%d(y, 0)" % i).replace(
+        "f%d(y - x)" % i, "f%d(y - x, 0)" % i)
+
+
+def timed(args, src, work, extra):
+    path = os.path.join(work, "input.vsl")
+    with open(path, "w") as f:
+        f.write(src)
+    with open(path, "rb") as stdin:
+        status, wall, _, stderr = suite.run(
+            [args.vsl, "-O%d" % args.opt] + extra, work, stdin, args.timeout)
+    if status != 0:
+        raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+    m = CACHE_LINE.search(stderr)
+    return wall, ("%s reused, %s compiled" % m.groups()) if m else ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--count", type=int, default=2000)
+    parser.add_argument("--opt", type=int, default=2)
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--timeout", type=float, default=600)
+    args = parser.parse_args()
+    args.vsl = os.path.abspath(args.vsl)
+
+    work = tempfile.mkdtemp(prefix="vsl-incremental-")
+    try:
+        base = generate(args.count)
+        body = edit_body(base, args.count)
+        proto = edit_prototype(body, args.count)
+        print("%-20s %10s  %s" % ("run", "wall (s)", "object cache"))
+        samples = [timed(args, base, work, [])[0] for _ in range(args.repeat)]
+        print("%-20s %10.4f" % ("no cache", statistics.median(samples)))
+
+        steps = [("cold", base), ("warm", base), ("edit body", body),
+                 ("edit prototype", proto)]
+        results = {name: [] for name, _ in steps}
+        for _ in range(args.repeat):
+            cache = os.path.join(work, "cache")
+            shutil.rmtree(cache, ignore_errors=True)
+            for name, src in steps:
+                results[name].append(timed(args, src, work, ["-cache-dir=" + cache]))
+        for name, _ in steps:
+            wall = statistics.median(r[0] for r in results[name])
+            print("%-20s %10.4f  %s" % (name, wall, results[name][-1][1]))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Measure parse time against -parse-threads.
+
+A program of COUNT functions (gen_functions.py) is compiled with
+--time-report=json at every thread count; reported are the median parse wall
+time and the speedup against one thread.
+
+usage: parse_scaling.py --vsl PATH [--count 20000] [--threads 1,2,4,8]
+                        [--repeat 3]
+"""
+import argparse
+import os
+import shutil
+import statistics
+import tempfile
+
+import run as suite
+
+
+def measure(args, src, work, threads):
+    samples = []
+    for _ in range(args.repeat):
+        with open(src, "rb") as stdin:
+            status, _, _, stderr = suite.run(
+                [args.vsl, "-O0", "-g0", "--time-report=json",
+                 "-parse-threads=%d" % threads], work, stdin, args.timeout)
+        if status != 0:
+            raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+        samples.append(suite.parse_report(stderr)[0]["phases"]["parse"]["wall"])
+    return statistics.median(samples)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--count", type=int, default=20000)
+    parser.add_argument("--threads", default=None,
+                        help="comma separated thread counts (default: powers "
+                             "of two up to the number of cores)")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--timeout", type=float, default=600)
+    args = parser.parse_args()
+    if args.threads:
+        counts = [int(t) for t in args.threads.split(",")]
+    else:
+        counts = [1]
+        while counts[-1] * 2 <= (os.cpu_count() or 1):
+            counts.append(counts[-1] * 2)
+
+    work = tempfile.mkdtemp(prefix="vsl-parse-")
+    try:
+        src = suite.materialize(
+            "functions", ["gen_functions.py", str(args.count)], work)
+        print("%-8s %12s %9s" % ("threads", "parse (s)", "speedup"))
+        base = None
+        for threads in counts:
+            wall = measure(args, src, work, threads)
+            base = base or wall
+            print("%-8d %12.4f %8.2fx" % (threads, wall, base / wall))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
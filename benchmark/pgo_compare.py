@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Compare run time with and without -profile-use on the branchy programs.
+
+For each program: one instrumented run (-profile-out) records the counts,
+then the program is compiled at -O2 with and without -profile-use and run
+under the JIT and as a linked output.o.  Medians of --repeat runs.
+
+usage: pgo_compare.py --vsl PATH [--repeat 5] [--only NAME,...]
+"""
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+import run as suite
+
+BRANCHY = ["branchy", "tight_loops", "recursion", "many_functions"]
+
+
+def timed_runs(args, src, work, runtime, extra):
+    jit, obj = [], []
+    for _ in range(args.repeat):
+        with open(src, "rb") as stdin:
+            status, _, _, stderr = suite.run(
+                [args.vsl, "-O2", "--time-report=json"] + extra, work, stdin,
+                args.timeout)
+        if status != 0:
+            raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+        jit.append(suite.parse_report(stderr)[0]["phases"]["run"]["wall"])
+        objs, ldflags = runtime
+        exe = os.path.join(work, "a.out")
+        subprocess.check_call([args.cxx, "-no-pie", os.path.join(work, "output.o")]
+                              + objs + ["-o", exe] + ldflags)
+        obj.append(suite.run([exe], work, timeout=args.timeout)[1])
+    return statistics.median(jit), statistics.median(obj)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--only", help="comma separated benchmark names")
+    parser.add_argument("--timeout", type=float, default=600)
+    args = parser.parse_args()
+    args.vsl = os.path.abspath(args.vsl)
+    names = args.only.split(",") if args.only else BRANCHY
+    programs = dict(suite.PROGRAMS)
+
+    work = tempfile.mkdtemp(prefix="vsl-pgo-")
+    try:
+        runtime = suite.build_runtime(work, args.cxx)
+        print("%-16s %-4s %12s %12s %8s" % ("benchmark", "mode", "no PGO (s)",
+                                              "PGO (s)", "speedup"))
+        for name in names:
+            src = suite.materialize(name, programs[name], work)
+            profile = os.path.join(work, name + ".prof")
+            with open(src, "rb") as stdin:
+                status, _, _, stderr = suite.run(
+                    [args.vsl, "-O2", "-profile-out=" + profile], work, stdin,
+                    args.timeout)
+            if status != 0:
+                sys.exit("training run of %s failed\n%s" % (name, stderr[-2000:]))
+            base = timed_runs(args, src, work, runtime, [])
+            pgo = timed_runs(args, src, work, runtime, ["-profile-use=" + profile])
+            for mode, b, p in zip(("jit", "obj"), base, pgo):
+                print("%-16s %-4s %12.4f %12.4f %7.2fx" % (name, mode, b, p, b / p))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
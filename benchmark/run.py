@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Run the VSL benchmark suite and compare it with a stored baseline.
+
+Every program is compiled by the driver at each optimization level with
+--time-report=json.  That one run gives the JIT numbers (compile, JIT and run
+time, peak RSS of the process); the output.o it also writes is then linked
+against the runtime and executed to give the object file numbers.  Each
+measurement is repeated and the median is kept.
+
+usage: run.py --vsl PATH [--levels 0,1,2,3] [--repeat 3] [--only NAME,...]
+              [--baseline baseline.json] [--update-baseline]
+              [--threshold 0.10] [--output results.json]
+
+Exits with status 1 when a metric regressed by more than the threshold
+against the baseline, 2 when a program failed to compile or run.
+"""
+import argparse
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCE_DIR = os.path.join(HERE, "..", "Chapter2")
+
+# name -> hand-written program, or generator command line
+PROGRAMS = [
+    ("recursion", "recursion.vsl"),
+    ("tight_loops", "tight_loops.vsl"),
+    ("print_heavy", "print_heavy.vsl"),
+    ("operators", "operators.vsl"),
+    ("branchy", "branchy.vsl"),
+    ("array_sum", "array_sum.vsl"),
+    ("array_dot", "array_dot.vsl"),
+    ("loop_kernels", "loop_kernels.vsl"),
+    ("builtin_kernels", "builtin_kernels.vsl"),
+    ("many_functions", ["gen_functions.py", "2000"]),
+    ("huge_function", ["gen_huge.py", "20000"]),
+    ("scopes", ["gen_scopes.py", "2000", "500"]),
+    ("deep_expression", ["gen_deep.py", "1000000"]),
+]
+
+# What the driver prints on stderr about input it could not compile.  It still
+# exits with status 0 after compiling what it could, so the time would be
+# meaningless.
+INPUT_ERRORS = ("invalid input:", "don't have main function!")
+
+# Differences below these are noise, whatever the ratio.
+MIN_DELTA = {"compile_s": 0.005, "jit_s": 0.005, "run_s": 0.005,
+             "rss_kb": 2048}
+
+
+def run(cmd, cwd, stdin=None, timeout=None):
+    """Run cmd and return (exit status, wall seconds, peak RSS in KB, stderr)."""
+    with tempfile.TemporaryFile() as err:
+        start = time.perf_counter()
+        proc = subprocess.Popen(cmd, cwd=cwd, stdin=stdin,
+                                stdout=subprocess.DEVNULL, stderr=err)
+        deadline = None if timeout is None else start + timeout
+        while True:
+            pid, status, usage = os.wait4(proc.pid, os.WNOHANG)
+            if pid:
+                break
+            if deadline is not None and time.perf_counter() > deadline:
+                proc.kill()
+                os.wait4(proc.pid, 0)
+                raise RuntimeError("timed out: %s" % " ".join(cmd))
+            time.sleep(0.001)
+        wall = time.perf_counter() - start
+        err.seek(0)
+        return (os.waitstatus_to_exitcode(status), wall, usage.ru_maxrss,
+                err.read().decode("utf-8", "replace"))
+
+
+def parse_report(stderr):
+    """Pull the --time-report=json object and main's result out of stderr.
+    Raises RuntimeError if the driver rejected part of the program."""
+    for marker in INPUT_ERRORS:
+        line = stderr.find(marker)
+        if line >= 0:
+            raise RuntimeError("driver rejected the program: %s"
+                               % stderr[line:].splitlines()[0])
+    start = stderr.rfind('{\n  "phases"')
+    if start < 0:
+        raise RuntimeError("no time report in driver output")
+    report = json.loads(stderr[start:])
+    marker = stderr.rfind("main return ", 0, start)
+    ret = None
+    if marker >= 0:
+        ret = int(stderr[marker + len("main return "):].split()[0])
+    return report, ret
+
+
+def build_runtime(work, cxx):
+    """Compile the runtime functions once; output.o files link against it."""
+    llvm_config = shutil.which("llvm-config") or "llvm-config"
+    cxxflags = subprocess.check_output([llvm_config, "--cxxflags"],
+                                       text=True).split()
+    ldflags = subprocess.check_output(
+        [llvm_config, "--ldflags", "--libs", "support", "--system-libs"],
+        text=True).split()
+    objs = []
+    for src in ("Runtime.cpp", "VectorKernels.cpp"):
+        obj = os.path.join(work, src.replace(".cpp", ".o"))
+        subprocess.check_call([cxx, "-O2", "-c", os.path.join(SOURCE_DIR, src),
+                               "-o", obj] + cxxflags)
+        objs.append(obj)
+    return objs, ldflags
+
+
+def materialize(name, spec, work):
+    """Return the path of the program's source, generating it if needed."""
+    if isinstance(spec, str):
+        return os.path.join(HERE, spec)
+    path = os.path.join(work, name + ".vsl")
+    with open(path, "w") as out:
+        subprocess.check_call([sys.executable, os.path.join(HERE, spec[0])]
+                              + spec[1:], stdout=out)
+    return path
+
+
+def measure_once(args, src, level, work, runtime):
+    """One compile + JIT run and one object file run of src at level."""
+    with open(src, "rb") as stdin:
+        status, _, rss, stderr = run([args.vsl, "-O%d" % level,
+                                      "--time-report=json"], work, stdin,
+                                     args.timeout)
+    if status != 0:
+        raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+    report, jit_ret = parse_report(stderr)
+    phases = {p: v["wall"] for p, v in report["phases"].items()}
+    front = phases["parse"] + phases["codegen"] + phases["optimize"]
+    jit = {"compile_s": front, "jit_s": phases["jit"], "run_s": phases["run"],
+           "rss_kb": rss}
+
+    objs, ldflags = runtime
+    exe = os.path.join(work, "a.out")
+    subprocess.check_call([args.cxx, "-no-pie", os.path.join(work, "output.o")]
+                          + objs + ["-o", exe] + ldflags)
+    status, wall, rss, stderr = run([exe], work, timeout=args.timeout)
+    if jit_ret is not None and status != jit_ret & 0xff:
+        raise RuntimeError("object file returned %d, JIT returned %d\n%s"
+                           % (status, jit_ret, stderr[-2000:]))
+    obj = {"compile_s": front + phases["emit"], "run_s": wall, "rss_kb": rss}
+    return jit, obj
+
+
+def median_of(samples):
+    return {k: statistics.median(s[k] for s in samples) for k in samples[0]}
+
+
+def compare(results, baseline, threshold):
+    """Print current vs baseline and return the number of regressions."""
+    regressions = 0
+    print("%-32s %-10s %12s %12s %8s" % ("benchmark", "metric", "baseline",
+                                          "current", "change"))
+    for key in sorted(results):
+        base = baseline.get(key)
+        for metric, value in sorted(results[key].items()):
+            old = base.get(metric) if base else None
+            if not old:
+                print("%-32s %-10s %12s %12.4f" % (key, metric, "-", value))
+                continue
+            change = value / old - 1
+            flag = ""
+            if abs(value - old) >= MIN_DELTA[metric]:
+                if change > threshold:
+                    flag = "  REGRESSED"
+                    regressions += 1
+                elif change < -threshold:
+                    flag = "  improved"
+            print("%-32s %-10s %12.4f %12.4f %+7.1f%%%s"
+                  % (key, metric, old, value, change * 100, flag))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"),
+                        help="C++ compiler used to link output.o")
+    parser.add_argument("--levels", default="0,1,2,3")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--only", help="comma separated benchmark names")
+    parser.add_argument("--timeout", type=float, default=600)
+    parser.add_argument("--baseline", default=os.path.join(HERE, "baseline.json"))
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="store this run as the new baseline")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative slowdown reported as a regression")
+    parser.add_argument("--output", help="also write the results here")
+    args = parser.parse_args()
+    args.vsl = os.path.abspath(args.vsl)
+    levels = [int(l) for l in args.levels.split(",")]
+    only = set(args.only.split(",")) if args.only else None
+
+    results = {}
+    failures = 0
+    work = tempfile.mkdtemp(prefix="vsl-bench-")
+    try:
+        runtime = build_runtime(work, args.cxx)
+        for name, spec in PROGRAMS:
+            if only and name not in only:
+                continue
+            src = materialize(name, spec, work)
+            for level in levels:
+                try:
+                    samples = [measure_once(args, src, level, work, runtime)
+                               for _ in range(args.repeat)]
+                except (RuntimeError, subprocess.CalledProcessError) as e:
+                    print("FAILED %s -O%d: %s" % (name, level, e),
+                          file=sys.stderr)
+                    failures += 1
+                    continue
+                results["%s/jit/O%d" % (name, level)] = median_of(
+                    [s[0] for s in samples])
+                results["%s/obj/O%d" % (name, level)] = median_of(
+                    [s[1] for s in samples])
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+    record = {
+        "machine": {"platform": platform.platform(),
+                    "processor": platform.processor() or platform.machine(),
+                    "cpus": os.cpu_count()},
+        "repeat": args.repeat,
+        "results": results,
+    }
+    if args.output:
+        with open(args.output, "w") as out:
+            json.dump(record, out, indent=2, sort_keys=True)
+
+    baseline = {}
+    if os.path.exists(args.baseline) and not args.update_baseline:
+        with open(args.baseline) as f:
+            stored = json.load(f)
+        if stored.get("machine") != record["machine"]:
+            print("warning: baseline was recorded on a different machine",
+                  file=sys.stderr)
+        baseline = stored["results"]
+    regressions = compare(results, baseline, args.threshold)
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as out:
+            json.dump(record, out, indent=2, sort_keys=True)
+        print("baseline written to %s" % args.baseline)
+    if failures:
+        return 2
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
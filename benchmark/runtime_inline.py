@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Compare run time with the runtime linked as bitcode and called natively.
+
+Each program is compiled at -O2 with -runtime-bc=none (PRINT calls the
+native putchard) and with the default vsl_runtime.bc (putchard inlined), and
+run under the JIT and as a vsl -o executable.  Medians of --repeat runs.
+
+usage: runtime_inline.py --vsl PATH [--repeat 5] [--only NAME,...]
+"""
+import argparse
+import os
+import shutil
+import statistics
+import tempfile
+
+import run as suite
+
+PRINTING = ["print_heavy", "operators", "branchy"]
+
+
+def timed_runs(args, src, work, extra):
+    jit, obj = [], []
+    exe = os.path.join(work, "a.out")
+    for _ in range(args.repeat):
+        with open(src, "rb") as stdin:
+            status, _, _, stderr = suite.run(
+                [args.vsl, "-O2", "--time-report=json"] + extra, work, stdin,
+                args.timeout)
+        if status != 0:
+            raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+        jit.append(suite.parse_report(stderr)[0]["phases"]["run"]["wall"])
+        with open(src, "rb") as stdin:
+            status, _, _, stderr = suite.run(
+                [args.vsl, "-O2", "-o", exe] + extra, work, stdin, args.timeout)
+        if status != 0:
+            raise RuntimeError("vsl -o exited with %d\n%s" % (status, stderr[-2000:]))
+        obj.append(suite.run([exe], work, timeout=args.timeout)[1])
+    return statistics.median(jit), statistics.median(obj)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--only", help="comma separated benchmark names")
+    parser.add_argument("--timeout", type=float, default=600)
+    args = parser.parse_args()
+    args.vsl = os.path.abspath(args.vsl)
+    if not os.path.exists(os.path.join(os.path.dirname(args.vsl),
+                                       "vsl_runtime.bc")):
+        print("warning: no vsl_runtime.bc next to %s; both columns call the "
+              "native runtime" % args.vsl)
+    names = args.only.split(",") if args.only else PRINTING
+    programs = dict(suite.PROGRAMS)
+
+    work = tempfile.mkdtemp(prefix="vsl-rtbc-")
+    try:
+        print("%-16s %-4s %12s %12s %8s" % ("benchmark", "mode", "native (s)",
+                                              "bitcode (s)", "speedup"))
+        for name in names:
+            src = suite.materialize(name, programs[name], work)
+            native = timed_runs(args, src, work, ["-runtime-bc=none"])
+            inlined = timed_runs(args, src, work, [])
+            for mode, n, b in zip(("jit", "obj"), native, inlined):
+                print("%-16s %-4s %12.4f %12.4f %7.2fx" % (name, mode, n, b, n / b))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Measure the memory of N processes running VSL code: JIT vs --shared.
+
+A program of COUNT functions (gen_functions.py) is
+  - run by N separate driver processes, each parsing, JIT-compiling and
+    running it: reported is N times their median peak RSS;
+  - built once with --shared into a library, which N host processes (a small
+    C program compiled against the generated header) dlopen and call at the
+    same time: reported is the sum of their PSS, the proportional set size
+    that splits shared pages among the processes mapping them, and the
+    median RSS of one host.
+
+Linux only (/proc/<pid>/smaps_rollup).
+
+usage: shared_memory.py --vsl PATH [--processes 16] [--count 2000]
+                        [--cc cc] [--repeat 3]
+"""
+import argparse
+import os
+import shutil
+import statistics
+import subprocess
+import tempfile
+
+import run as suite
+
+HOST = r"""
+#include <dlfcn.h>
+#include <stdio.h>
+#include LIBRARY_HEADER
+
+int main(int argc, char **argv) {
+	void *Lib = dlopen(argv[1], RTLD_NOW);
+	if (!Lib) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+	int (*F)(int) = (int (*)(int))dlsym(Lib, argv[2]);
+	if (!F) {
+		fprintf(stderr, "%s\n", dlerror());
+		return 1;
+	}
+	printf("%d\n", F(1));
+	fflush(stdout);
+	/* Stay alive, mapped, until the parent has measured. */
+	getchar();
+	return 0;
+}
+"""
+
+
+def smaps_kb(pid, field):
+    with open("/proc/%d/smaps_rollup" % pid) as f:
+        for line in f:
+            if line.startswith(field + ":"):
+                return int(line.split()[1])
+    raise RuntimeError("no %s in smaps_rollup of %d" % (field, pid))
+
+
+def measure_jit(args, src, work):
+    samples = []
+    for _ in range(args.repeat):
+        with open(src, "rb") as stdin:
+            status, _, rss, stderr = suite.run([args.vsl, "-O2"], work, stdin,
+                                               args.timeout)
+        if status != 0:
+            raise RuntimeError("driver exited with %d\n%s" % (status, stderr[-2000:]))
+        samples.append(rss)
+    return statistics.median(samples)
+
+
+def measure_shared(args, host, lib, function):
+    hosts = [subprocess.Popen([host, lib, function], stdin=subprocess.PIPE,
+                              stdout=subprocess.PIPE)
+             for _ in range(args.processes)]
+    try:
+        for proc in hosts:
+            if not proc.stdout.readline():
+                raise RuntimeError("host exited early")
+        pss = sum(smaps_kb(proc.pid, "Pss") for proc in hosts)
+        rss = statistics.median(smaps_kb(proc.pid, "Rss") for proc in hosts)
+    finally:
+        for proc in hosts:
+            proc.stdin.close()
+            proc.wait()
+    return pss, rss
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--processes", type=int, default=16)
+    parser.add_argument("--count", type=int, default=2000)
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--timeout", type=float, default=600)
+    args = parser.parse_args()
+    args.vsl = os.path.abspath(args.vsl)
+
+    work = tempfile.mkdtemp(prefix="vsl-shared-")
+    try:
+        src = suite.materialize(
+            "functions", ["gen_functions.py", str(args.count)], work)
+        lib = os.path.join(work, "libfunctions.so")
+        with open(src, "rb") as stdin:
+            status, _, _, stderr = suite.run(
+                [args.vsl, "-O2", "--shared", "-o", lib], work, stdin,
+                args.timeout)
+        if status != 0:
+            raise RuntimeError("vsl --shared exited with %d\n%s"
+                               % (status, stderr[-2000:]))
+        host_src = os.path.join(work, "host.c")
+        with open(host_src, "w") as out:
+            out.write(HOST)
+        host = os.path.join(work, "host")
+        subprocess.check_call([args.cc, "-O2", host_src, "-o", host,
+                               '-DLIBRARY_HEADER="libfunctions.h"',
+                               "-I", work, "-ldl"])
+
+        jit_rss = measure_jit(args, src, work)
+        samples = [measure_shared(args, host, lib, "f%d" % (args.count - 1))
+                   for _ in range(args.repeat)]
+        pss = statistics.median(s[0] for s in samples)
+        host_rss = statistics.median(s[1] for s in samples)
+
+        n = args.processes
+        print("%d processes, %d functions" % (n, args.count))
+        print("%-28s %12s" % ("", "KB"))
+        print("%-28s %12d" % ("JIT: RSS of one driver", jit_rss))
+        print("%-28s %12d" % ("JIT: %d x RSS" % n, n * jit_rss))
+        print("%-28s %12d" % ("shared: RSS of one host", host_rss))
+        print("%-28s %12d" % ("shared: PSS of %d hosts" % n, pss))
+        print("%-28s %11.1fx" % ("saving", n * jit_rss / pss))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Measure time to first output on piped input, with and without -stream.
+
+The program is a small main (printing one number) followed by COUNT unrelated
+functions.  A producer thread writes it into the driver's stdin one function
+at a time, sleeping --delay milliseconds after each, like a generator that is
+still running.  Reported are the median times until main's first output and
+until the driver exits.  With -stream the first should not grow with COUNT.
+
+usage: stream_latency.py --vsl PATH [--counts 100,1000,4000] [--delay 0.5]
+                         [--repeat 3]
+"""
+import argparse
+import statistics
+import subprocess
+import threading
+import time
+
+HEAD = ("FUNC g(x){\nRETURN x * 2 + 1\n}\n"
+        "FUNC main(){\nPRINT g(20), \"\\n\"\nRETURN 0\n}\n")
+
+
+def filler(i):
+    return ("FUNC h%d(x){\nVAR y\ny := x * %d + %d\nIF y < %d\nTHEN\n"
+            "RETURN y\nELSE\nRETURN y - x\nFI\n}\n" % (i, i % 7 + 1, i, i * 10))
+
+
+def feed(pipe, count, delay):
+    try:
+        pipe.write(HEAD.encode())
+        pipe.flush()
+        for i in range(count):
+            pipe.write(filler(i).encode())
+            pipe.flush()
+            if delay:
+                time.sleep(delay / 1000.0)
+    except BrokenPipeError:
+        pass
+    finally:
+        pipe.close()
+
+
+def measure(args, count, extra):
+    """Seconds until the driver printed main's result, and until it exited."""
+    start = time.perf_counter()
+    proc = subprocess.Popen([args.vsl, "-O2"] + extra, stdin=subprocess.PIPE,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                            cwd=args.workdir)
+    producer = threading.Thread(target=feed, args=(proc.stdin, count, args.delay))
+    producer.start()
+    first = None
+    for line in proc.stderr:
+        if first is None and line.startswith(b"main return "):
+            first = time.perf_counter() - start
+    proc.wait()
+    producer.join()
+    total = time.perf_counter() - start
+    if proc.returncode != 0 or first is None:
+        raise RuntimeError("driver failed with %d at %d functions"
+                           % (proc.returncode, count))
+    return first, total
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--vsl", required=True, help="compiler driver binary")
+    parser.add_argument("--counts", default="100,1000,4000")
+    parser.add_argument("--delay", type=float, default=0.5,
+                        help="milliseconds between two functions")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--workdir", default=None,
+                        help="where the batch mode writes output.o")
+    args = parser.parse_args()
+
+    print("%-8s %-7s %14s %12s" % ("count", "mode", "first out (s)", "total (s)"))
+    for count in (int(c) for c in args.counts.split(",")):
+        for mode, extra in (("batch", []), ("stream", ["-stream"])):
+            samples = [measure(args, count, extra) for _ in range(args.repeat)]
+            print("%-8d %-7s %14.4f %12.4f"
+                  % (count, mode, statistics.median(s[0] for s in samples),
+                     statistics.median(s[1] for s in samples)))
+
+
+if __name__ == "__main__":
+    main()